@@ -16,6 +16,8 @@
 
 #include <memory>
 
+#include <QList>
+#include <QPair>
 #include <QtGlobal>
 
 class Device;
@@ -57,11 +59,21 @@ public:
 
     QString path() const override;
 
+    /**< @return extents relative to firstByte() whose contents do not need to be copied */
+    const QList<QPair<qint64, qint64>>& unusedExtents() const {
+        return m_UnusedExtents;
+    }
+    /**< @param extents (offset, length) pairs relative to firstByte(), sorted by offset */
+    void setUnusedExtents(const QList<QPair<qint64, qint64>>& extents) {
+        m_UnusedExtents = extents;
+    }
+
 protected:
     Device& m_Device;
     const qint64 m_FirstByte;
     const qint64 m_LastByte;
     std::unique_ptr<CoreBackendDevice> m_BackendDevice;
+    QList<QPair<qint64, qint64>> m_UnusedExtents;
 };
 
 #endif
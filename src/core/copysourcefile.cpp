@@ -7,6 +7,8 @@
 
 #include "core/copysourcefile.h"
 
+#include "util/compressedbackup.h"
+
 #include <QFile>
 #include <QFileInfo>
 
@@ -19,18 +21,26 @@ CopySourceFile::CopySourceFile(const QString& filename) :
 {
 }
 
-/** Opens the file.
+/** Opens the file and checks if it is a compressed backup.
     @return true on success
 */
 bool CopySourceFile::open()
 {
-    return file().open(QIODevice::ReadOnly);
+    if (!file().open(QIODevice::ReadOnly))
+        return false;
+
+    CompressedBackup::Header header;
+    m_Compressed = CompressedBackup::parseHeader(file().peek(CompressedBackup::headerFrameSize), header);
+    m_UncompressedLength = header.sourceLength;
+    m_FileSystemType = header.fileSystemType;
+
+    return true;
 }
 
-/** Returns the length of the file in bytes.
-    @return length of the file in bytes.
+/** Returns the length of the data in the file in bytes.
+    @return length of the file in bytes, for compressed backups the length of the original data
 */
 qint64 CopySourceFile::length() const
 {
-    return QFileInfo(file()).size();
+    return isCompressed() ? m_UncompressedLength : QFileInfo(file()).size();
 }
@@ -45,6 +45,13 @@ public:
         return m_File.fileName();
     }
 
+    bool isCompressed() const {
+        return m_Compressed;    /**< @return true if the file is a compressed backup, valid after open() */
+    }
+    qint32 fileSystemType() const {
+        return m_FileSystemType;    /**< @return FileSystem::Type recorded in a compressed backup */
+    }
+
 protected:
     QFile& file() {
         return m_File;
@@ -55,6 +62,9 @@ protected:
 
 protected:
     QFile m_File;
+    bool m_Compressed = false;
+    qint64 m_UncompressedLength = 0;
+    qint32 m_FileSystemType = 0;
 };
 
 #endif
@@ -14,6 +14,7 @@
 CopySourceShred::CopySourceShred(qint64 s, bool randomShred) :
     CopySource(),
     m_Size(s),
+    m_RandomShred(randomShred),
     m_SourceFile(randomShred ? QStringLiteral("/dev/urandom") : QStringLiteral("/dev/zero"))
 {
 }
@@ -44,6 +44,9 @@ public:
     QString path() const override {
         return m_SourceFile.fileName();
     }
+    bool randomShred() const {
+        return m_RandomShred;    /**< @return true if random data is written instead of zeros */
+    }
 
 protected:
     QFile& sourceFile() {
@@ -58,6 +61,7 @@ protected:
 
 private:
     qint64 m_Size;
+    bool m_RandomShred;
     QFile m_SourceFile;
 };
 
@@ -42,6 +42,18 @@ public:
         return m_File.fileName();
     }
 
+    bool isCompressed() const {
+        return m_Compressed;    /**< @return true if a compressed backup is written */
+    }
+    qint32 fileSystemType() const {
+        return m_FileSystemType;    /**< @return FileSystem::Type recorded in a compressed backup */
+    }
+    /**< @param fileSystemType FileSystem::Type to record in the header of the compressed backup */
+    void setCompressed(qint32 fileSystemType) {
+        m_Compressed = true;
+        m_FileSystemType = fileSystemType;
+    }
+
 protected:
     QFile& file() {
         return m_File;
@@ -52,6 +64,8 @@ protected:
 
 protected:
     QFile m_File;
+    bool m_Compressed = false;
+    qint32 m_FileSystemType = 0;
 };
 
 #endif
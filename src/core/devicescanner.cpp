@@ -14,12 +14,27 @@
 #include "core/operationstack.h"
 #include "core/device.h"
 #include "core/diskdevice.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+#include "core/volumemanagerdevice.h"
 
+#include "fs/filesystem.h"
 #include "fs/lvm2_pv.h"
 
 #include "util/externalcommand.h"
+#include "util/globallog.h"
+#include "util/ueventmonitor.h"
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
+#include <QTimer>
+
+#include <KLocalizedString>
+
+// udev sends bursts of events while partitions are created or a disk is plugged in, wait for them to end
+constexpr int rescanDelay = 250;
 
 /** Constructs a DeviceScanner
     @param ostack the OperationStack where the devices will be created
@@ -31,6 +46,11 @@ DeviceScanner::DeviceScanner(QObject* parent, OperationStack& ostack) :
     setupConnections();
 }
 
+DeviceScanner::~DeviceScanner()
+{
+    stopMonitoring();
+}
+
 void DeviceScanner::setupConnections()
 {
     connect(CoreBackendManager::self()->backend(), &CoreBackend::scanProgress, this, &DeviceScanner::progress);
@@ -61,5 +81,303 @@ void DeviceScanner::scan()
     operationStack().sortDevices();
 }
 
+/** The full scan leaves out read-only disks, so do the rescans.
+    @param diskNode device node of a disk, e.g. /dev/sda
+    @return true if the disk is read-only
+*/
+static bool isReadOnly(const QString& diskNode)
+{
+    QFile readOnly(QStringLiteral("/sys/class/block/%1/ro").arg(diskNode.section(QLatin1Char('/'), -1)));
+    return readOnly.open(QIODevice::ReadOnly) && readOnly.readAll().trimmed() == "1";
+}
+
+/** Starts updating the OperationStack when devices are added, removed or changed.
+    @param socketPath path of a local datagram socket to read events from instead of udev, for tests
+    @return true if monitoring was started
+*/
+bool DeviceScanner::startMonitoring(const QString& socketPath)
+{
+    stopMonitoring();
+
+    m_Monitor = new UeventMonitor(socketPath, this);
+    if (!m_Monitor->isValid()) {
+        stopMonitoring();
+        return false;
+    }
+
+    m_RescanTimer = new QTimer(this);
+    m_RescanTimer->setSingleShot(true);
+    m_RescanTimer->setInterval(rescanDelay);
+
+    connect(m_Monitor, &UeventMonitor::blockDeviceEvent, this, &DeviceScanner::blockDeviceEvent);
+    connect(m_RescanTimer, &QTimer::timeout, this, &DeviceScanner::rescanPending);
+
+    // Rescans wait until the pending Operations are applied or undone
+    connect(&operationStack(), &OperationStack::operationsChanged, m_RescanTimer, [this] {
+        if (operationStack().size() == 0 && (!m_PendingDisks.isEmpty() || m_PendingVolumeManagers))
+            m_RescanTimer->start();
+    });
+
+    // Once a mapping is removed, sysfs no longer tells which disk it was on
+    const QStringList mappings = QDir(QStringLiteral("/sys/class/block")).entryList({ QStringLiteral("dm-*") }, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& name : mappings)
+        m_MappedDisks.insert(QStringLiteral("/dev/") + name, mappedDisks(QStringLiteral("/dev/") + name));
+
+    return true;
+}
+
+/** Stops updating the OperationStack, events that were not handled yet are dropped. */
+void DeviceScanner::stopMonitoring()
+{
+    delete m_Monitor;
+    m_Monitor = nullptr;
+    delete m_RescanTimer;
+    m_RescanTimer = nullptr;
+
+    if (m_RescanThread) {
+        m_RescanThread->wait();
+        delete m_RescanThread;
+        m_RescanThread = nullptr;
+        discardRescan();
+    }
+
+    m_PendingDisks.clear();
+    m_PendingVolumeManagers = false;
+    m_MappedDisks.clear();
+}
+
+void DeviceScanner::blockDeviceEvent(const QString& action, const QString& deviceNode, const QString& diskNode)
+{
+    if (deviceNode.startsWith(QStringLiteral("/dev/dm-")) || deviceNode.startsWith(QStringLiteral("/dev/md"))) {
+        // LVs and RAID arrays are not disks, they belong to volume manager devices
+        m_PendingVolumeManagers = true;
+
+        // Opening or closing a LUKS mapping changes the state of the partition it maps
+        if (deviceNode.startsWith(QStringLiteral("/dev/dm-"))) {
+            if (action != QStringLiteral("remove"))
+                m_MappedDisks.insert(deviceNode, mappedDisks(deviceNode));
+
+            for (const QString& disk : m_MappedDisks.value(deviceNode))
+                if (!m_PendingDisks.contains(disk) && !isReadOnly(disk))
+                    m_PendingDisks.insert(disk, false);
+
+            if (action == QStringLiteral("remove"))
+                m_MappedDisks.remove(deviceNode);
+        }
+    } else {
+        if (isReadOnly(diskNode))
+            return;
+
+        const bool removed = action == QStringLiteral("remove") && deviceNode == diskNode;
+        m_PendingDisks.insert(diskNode, removed);
+    }
+
+    m_RescanTimer->start();
+}
+
+/** Starts scanning the disks that events were received for in the rescan thread. */
+void DeviceScanner::rescanPending()
+{
+    // A full scan replaces everything anyway, and one rescan at a time is enough. Try again
+    // when they are done.
+    if (isRunning() || m_RescanThread) {
+        m_RescanTimer->start();
+        return;
+    }
+
+    // Pending Operations point to Devices and Partitions they do not target, too, e.g. the
+    // source of a copy or a backup, or the PVs of a volume group. Replacing any Device could
+    // free what they point to, so wait until they are applied or undone.
+    if (operationStack().size() > 0) {
+        Log(Log::Level::warning) << xi18nc("@info:status", "Devices changed, but they are not scanned again while operations are pending.");
+        return;
+    }
+
+    m_RescanDisks = m_PendingDisks;
+    m_RescanVolumeManagers = m_PendingVolumeManagers;
+    m_PendingDisks.clear();
+    m_PendingVolumeManagers = false;
+
+    for (auto it = m_RescanDisks.cbegin(); it != m_RescanDisks.cend(); ++it) {
+        const Device* oldDevice = operationStack().findDevice(it.key());
+        if (oldDevice && holdsVolumeManagerMembers(oldDevice->partitionTable()))
+            m_RescanVolumeManagers = true;
+    }
+
+    if (m_RescanDisks.isEmpty() && !m_RescanVolumeManagers)
+        return;
+
+    // Scanning runs sfdisk, blkid, lvm and more, which must not block the thread the
+    // OperationStack lives in. The thread only reads the system and creates new devices.
+    m_RescanThread = QThread::create([this] {
+        for (auto it = m_RescanDisks.cbegin(); it != m_RescanDisks.cend(); ++it) {
+            Device* newDevice = it.value() ? nullptr : CoreBackendManager::self()->backend()->scanDevice(it.key());
+            m_ScannedDisks.insert(it.key(), newDevice);
+
+            if (newDevice && holdsVolumeManagerMembers(newDevice->partitionTable()))
+                m_RescanVolumeManagers = true;
+        }
+
+        if (m_RescanVolumeManagers)
+            m_ScannedVolumeManagers = VolumeManagerDevice::scanVolumeManagerDevices();
+    });
+
+    connect(m_RescanThread, &QThread::finished, this, &DeviceScanner::rescanFinished);
+    m_RescanThread->start();
+}
+
+/** Updates the OperationStack with the devices the rescan thread found. */
+void DeviceScanner::rescanFinished()
+{
+    if (m_RescanThread == nullptr || sender() != m_RescanThread)
+        return;
+
+    m_RescanThread->wait();
+    m_RescanThread->deleteLater();
+    m_RescanThread = nullptr;
+
+    // A full scan started in the meantime and replaces everything
+    if (isRunning()) {
+        discardRescan();
+        return;
+    }
+
+    // Operations were added while the rescan thread ran, scan again once they are done
+    if (operationStack().size() > 0) {
+        for (auto it = m_RescanDisks.cbegin(); it != m_RescanDisks.cend(); ++it)
+            if (!m_PendingDisks.contains(it.key()))
+                m_PendingDisks.insert(it.key(), it.value());
+        m_PendingVolumeManagers = m_PendingVolumeManagers || m_RescanVolumeManagers;
+        discardRescan();
+        return;
+    }
+
+    for (auto it = m_ScannedDisks.cbegin(); it != m_ScannedDisks.cend(); ++it) {
+        Device* oldDevice = operationStack().findDevice(it.key());
+        Device* newDevice = it.value();
+
+        if (oldDevice && newDevice)
+            operationStack().replaceDevice(oldDevice, newDevice);
+        else if (oldDevice)
+            operationStack().removeDevice(oldDevice);
+        else if (newDevice)
+            operationStack().insertDevice(newDevice);
+    }
+    m_ScannedDisks.clear();
+
+    // The volume manager devices point to the Partitions of the disks their PVs are on, so
+    // they are replaced together with those disks
+    if (m_RescanVolumeManagers) {
+        updateVolumeManagers();
+        m_ScannedVolumeManagers.clear();
+    }
+
+    // Events that arrived while the rescan thread ran
+    if (!m_PendingDisks.isEmpty() || m_PendingVolumeManagers)
+        m_RescanTimer->start();
+}
+
+/** Replaces the volume manager devices with those the rescan thread found. */
+void DeviceScanner::updateVolumeManagers()
+{
+    QList<Device*> oldDevices;
+    {
+        QReadLocker lockDevices(&operationStack().lock());
+        for (Device* d : std::as_const(operationStack().previewDevices()))
+            if (dynamic_cast<VolumeManagerDevice*>(d))
+                oldDevices.append(d);
+    }
+
+    for (Device* oldDevice : std::as_const(oldDevices)) {
+        Device* newDevice = nullptr;
+        for (Device* d : std::as_const(m_ScannedVolumeManagers))
+            if (d->deviceNode() == oldDevice->deviceNode())
+                newDevice = d;
+
+        if (newDevice)
+            operationStack().replaceDevice(oldDevice, newDevice);
+        else
+            operationStack().removeDevice(oldDevice);
+    }
+
+    for (Device* newDevice : std::as_const(m_ScannedVolumeManagers)) {
+        bool known = false;
+        for (const Device* d : std::as_const(oldDevices))
+            if (d->deviceNode() == newDevice->deviceNode())
+                known = true;
+
+        if (!known)
+            operationStack().insertDevice(newDevice);
+    }
+
+    // The PV lists still point to the Partitions of the disks before they were replaced
+    QList<Device*> devices;
+    {
+        QReadLocker lockDevices(&operationStack().lock());
+        devices = operationStack().previewDevices();
+    }
+    VolumeManagerDevice::updateMembers(devices);
+}
+
+/** Deletes what the rescan thread found. */
+void DeviceScanner::discardRescan()
+{
+    qDeleteAll(m_ScannedDisks);
+    m_ScannedDisks.clear();
+    qDeleteAll(m_ScannedVolumeManagers);
+    m_ScannedVolumeManagers.clear();
+}
+
+/** @param deviceNode device node of a device mapper device, e.g. /dev/dm-0
+    @return the disks of the partitions or disks the device maps directly, e.g. /dev/sda
+            for a LUKS mapping of /dev/sda2. LVs and RAID arrays below it are left out.
+*/
+QStringList DeviceScanner::mappedDisks(const QString& deviceNode)
+{
+    QStringList disks;
+
+    const QString name = deviceNode.section(QLatin1Char('/'), -1);
+    const QStringList slaves = QDir(QStringLiteral("/sys/class/block/%1/slaves").arg(name)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& slave : slaves) {
+        if (slave.startsWith(QStringLiteral("dm-")) || slave.startsWith(QStringLiteral("md")))
+            continue;
+
+        // /sys/class/block/sda2 links to .../block/sda/sda2, a disk to .../block/sda
+        const QString path = QFileInfo(QStringLiteral("/sys/class/block/") + slave).canonicalFilePath();
+        const QString disk = QFile::exists(path + QStringLiteral("/partition")) ? path.section(QLatin1Char('/'), -2, -2) : slave;
+        if (!disk.isEmpty() && !disks.contains(QStringLiteral("/dev/") + disk))
+            disks.append(QStringLiteral("/dev/") + disk);
+    }
+
+    return disks;
+}
+
+/** @param node the PartitionNode to search
+    @return true if a Partition below the node is a LVM PV, a RAID member or encrypted
+*/
+bool DeviceScanner::holdsVolumeManagerMembers(const PartitionNode* node)
+{
+    if (node == nullptr)
+        return false;
+
+    for (const auto &child : node->children()) {
+        const Partition* p = dynamic_cast<const Partition*>(child);
+        if (p == nullptr)
+            continue;
+
+        // An LV that was never probed can not hold anything
+        if (!p->isProbed())
+            continue;
+
+        const FileSystem::Type type = p->fileSystem().type();
+        if (type == FileSystem::Type::Lvm2_PV || type == FileSystem::Type::LinuxRaidMember || type == FileSystem::Type::Luks || type == FileSystem::Type::Luks2)
+            return true;
+
+        if (holdsVolumeManagerMembers(child))
+            return true;
+    }
+
+    return false;
+}
 
 #include "moc_devicescanner.cpp"
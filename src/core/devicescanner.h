@@ -12,14 +12,30 @@
 
 #include "util/libpartitionmanagerexport.h"
 
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
 #include <QThread>
 
+class Device;
 class OperationStack;
+class PartitionNode;
+class QTimer;
+class UeventMonitor;
 
 /** Thread to scan for all available Devices on this computer.
 
     This class is used to find all Devices on the computer and to create new Device instances for each of them. It's subclassing QThread to run asynchronously.
 
+    After a full scan, startMonitoring() keeps the OperationStack up to date with the system: when
+    udev reports that a disk or one of its partitions was added, removed or changed, only that disk
+    is scanned again and replaced in place, and the volume manager devices only if the disk holds
+    or held a PV or RAID member. Opening or closing a LUKS mapping rescans the disk it is on.
+    While Operations are pending, nothing is scanned again: they point to Devices and Partitions,
+    and the rescans wait until the Operations are applied or undone. The rescans run in a thread
+    of their own, only the OperationStack is updated in the thread the DeviceScanner lives in.
+
     @author Volker Lanz <vl@fidra.de>
 */
 class LIBKPMCORE_EXPORT DeviceScanner : public QThread
@@ -28,12 +44,16 @@ class LIBKPMCORE_EXPORT DeviceScanner : public QThread
 
 public:
     DeviceScanner(QObject* parent, OperationStack& ostack);
+    ~DeviceScanner() override;
 
 public:
     void clear(); /**< clear Devices and the OperationStack */
     void scan(); /**< do the actual scanning; blocks if called directly */
     void setupConnections();
 
+    bool startMonitoring(const QString& socketPath = QString());
+    void stopMonitoring();
+
 Q_SIGNALS:
     void progress(const QString& deviceNode, int progress);
 
@@ -47,7 +67,27 @@ protected:
     }
 
 private:
+    void blockDeviceEvent(const QString& action, const QString& deviceNode, const QString& diskNode);
+    void rescanPending();
+    void rescanFinished();
+    void updateVolumeManagers();
+    void discardRescan();
+    static QStringList mappedDisks(const QString& deviceNode);
+    static bool holdsVolumeManagerMembers(const PartitionNode* node);
+
     OperationStack& m_OperationStack;
+    UeventMonitor* m_Monitor = nullptr;
+    QTimer* m_RescanTimer = nullptr;
+    QHash<QString, bool> m_PendingDisks; // disk device node, true if it was removed
+    bool m_PendingVolumeManagers = false;
+    QHash<QString, QStringList> m_MappedDisks; // device mapper node, disks it maps partitions of
+
+    // Set up before the rescan thread starts and filled in by it
+    QThread* m_RescanThread = nullptr;
+    QHash<QString, bool> m_RescanDisks;
+    bool m_RescanVolumeManagers = false;
+    QHash<QString, Device*> m_ScannedDisks;
+    QList<Device*> m_ScannedVolumeManagers;
 };
 
 #endif
@@ -12,6 +12,8 @@
 #include <algorithm>
 #include <array>
 
+#include <sys/stat.h>
+
 #if defined(Q_OS_LINUX)
     #include <blkid/blkid.h>
 #endif
@@ -19,15 +21,35 @@
 #include <QChar>
 #include <QDebug>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QRegularExpression>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QVector>
 
 static void parseFsSpec(const QString& m_fsSpec, FstabEntry::Type& m_entryType, QString& m_deviceNode);
 static QString findBlkIdDevice(const char *token, const QString& value);
 static void writeEntry(QTextStream& s, const FstabEntry& entry, std::array<unsigned int, 4> columnWidth);
 std::array<unsigned int, 4> fstabColumnWidth(const FstabEntryList& fstabEntries);
 
+/** Mount points of an fstab file, keyed by the canonical path of the device node. */
+struct FstabIndex
+{
+    qint64 modified = -1;
+    qint64 size = -1;
+    QVector<qint64> deviceStamp;
+    QHash<QString, QStringList> mountPoints;
+};
+
+// Device nodes that UUID=, LABEL=, etc. resolved to, valid while the stamp is unchanged
+static QMutex tagCacheMutex;
+static QVector<qint64> tagCacheStamp;
+static QHash<QString, QString> tagCache;
+
+static QMutex fstabIndexMutex;
+static QHash<QString, FstabIndex> fstabIndices;
+
 struct FstabEntryPrivate
 {
     QString m_fsSpec;
@@ -209,16 +231,66 @@ void FstabEntry::setPassNumber(int s)
     d->m_passNumber = s;
 }
 
+/** @return modification time of path in nanoseconds, -1 if it does not exist */
+static qint64 modificationTime(const QString& path, qint64* size = nullptr)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0)
+        return -1;
+
+    if (size)
+        *size = st.st_size;
+    return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+/** Device nodes and the udev symlinks that fstab entries are resolved through only change
+    together with the modification time of the directories they live in.
+    @return modification times of those directories
+*/
+static QVector<qint64> deviceStamp()
+{
+    static const QStringList directories = {
+        QStringLiteral("/dev"),
+        QStringLiteral("/dev/mapper"),
+        QStringLiteral("/dev/disk/by-uuid"),
+        QStringLiteral("/dev/disk/by-label"),
+        QStringLiteral("/dev/disk/by-partuuid"),
+        QStringLiteral("/dev/disk/by-partlabel"),
+    };
+
+    QVector<qint64> stamp;
+    stamp.reserve(directories.size());
+    for (const QString& directory : directories)
+        stamp.append(modificationTime(directory));
+
+    return stamp;
+}
+
 QStringList possibleMountPoints(const QString& deviceNode, const QString& fstabPath)
 {
-    QStringList mountPoints;
-    QString canonicalPath = QFileInfo(deviceNode).canonicalFilePath();
-    const FstabEntryList fstabEntryList = readFstabEntries( fstabPath );
-    for (const FstabEntry &entry : fstabEntryList)
-        if (QFileInfo(entry.deviceNode()).canonicalFilePath() == canonicalPath)
-            mountPoints.append(entry.mountPoint());
-
-    return mountPoints;
+    // Take the stamps before reading, a change in between then only causes another rebuild.
+    const QVector<qint64> devices = deviceStamp();
+    qint64 size = -1;
+    const qint64 modified = modificationTime(fstabPath, &size);
+
+    QMutexLocker locker(&fstabIndexMutex);
+    FstabIndex& index = fstabIndices[fstabPath];
+    if (index.modified != modified || index.size != size || index.deviceStamp != devices) {
+        index.modified = modified;
+        index.size = size;
+        index.deviceStamp = devices;
+        index.mountPoints.clear();
+
+        const FstabEntryList fstabEntryList = readFstabEntries( fstabPath );
+        for (const FstabEntry &entry : fstabEntryList) {
+            const QString canonicalPath = QFileInfo(entry.deviceNode()).canonicalFilePath();
+            if (!canonicalPath.isEmpty())
+                index.mountPoints[canonicalPath].append(entry.mountPoint());
+        }
+    }
+
+    const QString canonicalPath = QFileInfo(deviceNode).canonicalFilePath();
+    return canonicalPath.isEmpty() ? QStringList() : index.mountPoints.value(canonicalPath);
 }
 
 static QString findBlkIdDevice(const char *token, const QString& value)
@@ -226,10 +298,25 @@ static QString findBlkIdDevice(const char *token, const QString& value)
     QString rval;
 
 #if defined(Q_OS_LINUX)
+    const QString tag = QLatin1String(token) + QLatin1Char('=') + value;
+    const QVector<qint64> stamp = deviceStamp();
+
+    QMutexLocker locker(&tagCacheMutex);
+    if (tagCacheStamp != stamp) {
+        tagCacheStamp = stamp;
+        tagCache.clear();
+    }
+
+    const auto it = tagCache.constFind(tag);
+    if (it != tagCache.cend())
+        return it.value();
+
     if (char* c = blkid_evaluate_tag(token, value.toLocal8Bit().constData(), nullptr)) {
         rval = QString::fromLocal8Bit(c);
         free(c);
     }
+
+    tagCache.insert(tag, rval);
 #else
     Q_UNUSED(token)
     Q_UNUSED(value)
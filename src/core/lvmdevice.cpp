@@ -8,6 +8,7 @@
 */
 
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
 #include "core/partition.h"
 #include "core/partitiontable.h"
 #include "core/volumemanagerdevice_p.h"
@@ -92,7 +93,8 @@ void LvmDevice::initPartitions()
     qint64 lastUsable  = totalPE() - 1;
     PartitionTable* pTable = new PartitionTable(PartitionTable::vmd, firstUsable, lastUsable);
 
-    for (const auto &p : scanPartitions(pTable)) {
+    QList<Partition*> inactive;
+    for (const auto &p : scanPartitions(pTable, inactive)) {
         LVSizeMap()->insert(p->partitionPath(), p->length());
         pTable->append(p);
     }
@@ -102,6 +104,16 @@ void LvmDevice::initPartitions()
     else
         pTable = new PartitionTable(PartitionTable::vmd, firstUsable, lastUsable);
 
+    // Inactive LVs, e.g. thin snapshots, are listed from the LVM metadata only. They are
+    // activated and probed when somebody first asks about them. Computing the unallocated
+    // space above looks at the roles of every LV, so the probes are only set up now.
+    for (const auto &p : std::as_const(inactive)) {
+        p->setProbe([this] (Partition& lv) {
+            activateLV(lv.partitionPath());
+            probePartition(lv);
+        });
+    }
+
     setPartitionTable(pTable);
 }
 
@@ -109,14 +121,18 @@ void LvmDevice::initPartitions()
  *  Scan LVM LV Partitions
  *
  *  @param pTable Virtual PartitionTable of LVM device
+ *  @param inactive receives the LVs that are not probed yet
  *  @return an initialized Partition(LV) list
  */
-const QList<Partition*> LvmDevice::scanPartitions(PartitionTable* pTable) const
+const QList<Partition*> LvmDevice::scanPartitions(PartitionTable* pTable, QList<Partition*>& inactive) const
 {
     QList<Partition*> pList;
     for (const auto &lvPath : partitionNodes()) {
-        Partition *p = scanPartition(lvPath, pTable);
+        bool isInactive = false;
+        Partition *p = scanPartition(lvPath, pTable, isInactive);
         pList.append(p);
+        if (isInactive)
+            inactive.append(p);
     }
     return pList;
 }
@@ -133,16 +149,48 @@ const QList<Partition*> LvmDevice::scanPartitions(PartitionTable* pTable) const
  *
  * @param lvPath LVM Logical Volume path
  * @param pTable Abstract partition table representing partitions of LVM Volume Group
+ * @param inactive set to true if the LV is inactive and was not probed
  * @return initialized Partition(LV)
  */
-Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTable) const
+Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTable, bool& inactive) const
 {
-    activateLV(lvPath);
-
     qint64 lvSize = getTotalLE(lvPath);
     qint64 startSector = mappedSector(lvPath, 0);
     qint64 endSector = startSector + lvSize - 1;
 
+    FileSystem* fs = FileSystemFactory::create(FileSystem::Type::Unknown, 0, lvSize - 1, logicalSize());
+
+    Partition* part = new Partition(pTable,
+                    *this,
+                    PartitionRole(PartitionRole::Lvm_Lv),
+                    fs,
+                    startSector,
+                    endSector,
+                    lvPath,
+                    PartitionTable::Flag::None);
+
+    // Inactive LVs keep the placeholder, see initPartitions()
+    LvmReport::LogicalVolume lv;
+    const bool known = LvmReport::self().logicalVolume(lvPath, lv);
+    inactive = known && !lv.active;
+    if (!inactive) {
+        if (!known)
+            activateLV(lvPath);
+        probePartition(*part);
+    }
+
+    return part;
+}
+
+/** detect the file system, label, UUID and mount status of an active LV
+ *
+ * @param p the Partition(LV) to probe, its placeholder file system is replaced
+ */
+void LvmDevice::probePartition(Partition& p) const
+{
+    const QString lvPath = p.partitionPath();
+    const qint64 lvSize = p.length();
+
     FileSystem::Type type = FileSystem::detectFileSystem(lvPath);
     FileSystem* fs = FileSystemFactory::create(type, 0, lvSize - 1, logicalSize());
     fs->scan(lvPath);
@@ -179,17 +227,11 @@ Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTabl
     if (fs->supportGetUUID() != FileSystem::cmdSupportNone)
         fs->setUUID(fs->readUUID(lvPath));
 
-    Partition* part = new Partition(pTable,
-                    *this,
-                    PartitionRole(r),
-                    fs,
-                    startSector,
-                    endSector,
-                    lvPath,
-                    PartitionTable::Flag::None,
-                    mountPoint,
-                    mounted);
-    return part;
+    p.deleteFileSystem();
+    p.setFileSystem(fs);
+    p.setRoles(PartitionRole(r));
+    p.setMountPoint(mountPoint);
+    p.setMounted(mounted);
 }
 
 /** scan and construct list of initialized LvmDevice objects.
@@ -198,29 +240,66 @@ Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTabl
  */
 void LvmDevice::scanSystemLVM(QList<Device*>& devices)
 {
-    LvmDevice::s_OrphanPVs.clear();
+    for (const auto &d : scanVolumeGroups())
+        devices.append(d);
+
+    updatePhysicalVolumes(devices);
+}
+
+/** construct initialized LvmDevice objects for all VGs, without their physical volumes
+ *
+ *  This only reads the system, so it may run in any thread. See updatePhysicalVolumes().
+ *
+ *  @return the LvmDevices, owned by the caller
+ */
+QList<LvmDevice*> LvmDevice::scanVolumeGroups()
+{
+    // Every scan starts from a new snapshot, whatever was cached before
+    LvmReport::self().invalidate();
 
     QList<LvmDevice*> lvmList;
     for (const auto &vgName : getVGs()) {
         lvmList.append(new LvmDevice(vgName));
     }
 
+    return lvmList;
+}
+
+/** rebuild LVM::pvList::list() and the physical volumes of every LvmDevice
+ *
+ *  The lists point to Partitions of the devices, so they have to be rebuilt whenever
+ *  a device that holds a PV is replaced.
+ *
+ *  @param devices all Devices, including the LvmDevices
+ */
+void LvmDevice::updatePhysicalVolumes(const QList<Device*>& devices)
+{
+    LvmDevice::s_OrphanPVs.clear();
+
+    QList<Device*> otherList;
+    QList<LvmDevice*> lvmList;
+    for (const auto &d : devices) {
+        if (LvmDevice* lvm = dynamic_cast<LvmDevice*>(d))
+            lvmList.append(lvm);
+        else
+            otherList.append(d);
+    }
+
     // Some LVM operations require additional information about LVM physical volumes which we store in LVM::pvList::list()
     LVM::pvList::list().clear();
-    LVM::pvList::list().append(FS::lvm2_pv::getPVs(devices));
+    LVM::pvList::list().append(FS::lvm2_pv::getPVs(otherList));
 
     // Look for LVM physical volumes in LVM VGs
-    for (const auto &d : lvmList) {
-        devices.append(d);
+    for (const auto &d : lvmList)
         LVM::pvList::list().append(FS::lvm2_pv::getPVinNode(d->partitionTable()));
-    }
 
     // Inform LvmDevice about which physical volumes form that particular LvmDevice
-    for (const auto &d : lvmList)
+    for (const auto &d : lvmList) {
+        d->physicalVolumes().clear();
         for (const auto &p : std::as_const(LVM::pvList::list()))
             if (p.vgName() == d->name())
                 d->physicalVolumes().append(p.partition());
-
+    }
 }
 
 qint64 LvmDevice::mappedSector(const QString& lvPath, qint64 sector) const
@@ -264,6 +343,9 @@ qint64 LvmDevice::partitionSize(QString& partitionPath) const
 const QStringList LvmDevice::getVGs()
 {
     QStringList vgList;
+    if (LvmReport::self().volumeGroupNames(vgList))
+        return vgList;
+
     QString output = getField(QStringLiteral("vg_name"));
     if (!output.isEmpty()) {
         const QStringList vgNameList = output.split(QLatin1Char('\n'), Qt::SkipEmptyParts);
@@ -276,6 +358,10 @@ const QStringList LvmDevice::getVGs()
 
 const QStringList LvmDevice::getLVs(const QString& vgName)
 {
+    LvmReport::VolumeGroup vg;
+    if (LvmReport::self().volumeGroup(vgName, vg))
+        return vg.lvPaths;
+
     QStringList lvPathList;
     QString cmdOutput = getField(QStringLiteral("lv_path"), vgName);
 
@@ -290,12 +376,20 @@ const QStringList LvmDevice::getLVs(const QString& vgName)
 
 qint64 LvmDevice::getPeSize(const QString& vgName)
 {
+    LvmReport::VolumeGroup vg;
+    if (LvmReport::self().volumeGroup(vgName, vg))
+        return vg.extentSize;
+
     QString val = getField(QStringLiteral("vg_extent_size"), vgName);
     return val.isEmpty() ? -1 : val.toLongLong();
 }
 
 qint64 LvmDevice::getTotalPE(const QString& vgName)
 {
+    LvmReport::VolumeGroup vg;
+    if (LvmReport::self().volumeGroup(vgName, vg))
+        return vg.extentCount;
+
     QString val = getField(QStringLiteral("vg_extent_count"), vgName);
     return val.isEmpty() ? -1 : val.toInt();
 }
@@ -307,13 +401,18 @@ qint64 LvmDevice::getAllocatedPE(const QString& vgName)
 
 qint64 LvmDevice::getFreePE(const QString& vgName)
 {
+    LvmReport::VolumeGroup vg;
+    if (LvmReport::self().volumeGroup(vgName, vg))
+        return vg.freeCount;
+
     QString val =  getField(QStringLiteral("vg_free_count"), vgName);
     return val.isEmpty() ? -1 : val.toInt();
 }
 
 QString LvmDevice::getUUID(const QString& vgName)
 {
-    QString val = getField(QStringLiteral("vg_uuid"), vgName);
+    LvmReport::VolumeGroup vg;
+    QString val = LvmReport::self().volumeGroup(vgName, vg) ? vg.uuid : getField(QStringLiteral("vg_uuid"), vgName);
     return val.isEmpty() ? QStringLiteral("---") : val;
 
 }
@@ -348,6 +447,10 @@ QString LvmDevice::getField(const QString& fieldName, const QString& vgName)
 
 qint64 LvmDevice::getTotalLE(const QString& lvPath)
 {
+    LvmReport::LogicalVolume lv;
+    if (LvmReport::self().logicalVolume(lvPath, lv) && lv.extents >= 0)
+        return lv.extents;
+
     ExternalCommand cmd(QStringLiteral("lvm"),
             { QStringLiteral("lvdisplay"),
               lvPath});
@@ -370,7 +473,7 @@ bool LvmDevice::removeLV(Report& report, LvmDevice& d, Partition& p)
               QStringLiteral("--yes"),
               p.partitionPath()});
 
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
+    if (LvmReport::runChange(cmd)) {
         d.partitionTable()->remove(&p);
         return  true;
     }
@@ -388,7 +491,7 @@ bool LvmDevice::createLV(Report& report, LvmDevice& d, Partition& p, const QStri
               lvName,
               d.name()});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::createLVSnapshot(Report& report, Partition& p, const QString& name, const qint64 extents)
@@ -404,7 +507,7 @@ bool LvmDevice::createLVSnapshot(Report& report, Partition& p, const QString& na
               QStringLiteral("--name"),
               name,
               p.partitionPath() });
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::resizeLV(Report& report, Partition& p)
@@ -417,7 +520,7 @@ bool LvmDevice::resizeLV(Report& report, Partition& p)
               QString::number(p.length()),
               p.partitionPath()});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::removePV(Report& report, LvmDevice& d, const QString& pvPath)
@@ -427,7 +530,7 @@ bool LvmDevice::removePV(Report& report, LvmDevice& d, const QString& pvPath)
               d.name(),
               pvPath});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::insertPV(Report& report, LvmDevice& d, const QString& pvPath)
@@ -438,7 +541,7 @@ bool LvmDevice::insertPV(Report& report, LvmDevice& d, const QString& pvPath)
               d.name(),
               pvPath});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::movePV(Report& report, const QString& pvPath, const QStringList& destinations)
@@ -446,14 +549,15 @@ bool LvmDevice::movePV(Report& report, const QString& pvPath, const QStringList&
     if (FS::lvm2_pv::getAllocatedPE(pvPath) <= 0)
         return true;
 
-    QStringList args = { QStringLiteral("pvmove") };
+    QStringList args = { QStringLiteral("pvmove"), QStringLiteral("--interval"), QStringLiteral("1") };
     args << pvPath;
     if (!destinations.isEmpty())
         for (const auto &destPath : destinations)
             args << destPath.trimmed();
 
     ExternalCommand cmd(report, QStringLiteral("lvm"), args);
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    cmd.setProgressParser(FS::lvm2_pv::pvmoveProgress);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::createVG(Report& report, const QString vgName, const QVector<const Partition*>& pvList, const qint32 peSize)
@@ -469,7 +573,7 @@ bool LvmDevice::createVG(Report& report, const QString vgName, const QVector<con
 
     ExternalCommand cmd(report, QStringLiteral("lvm"), args);
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::removeVG(Report& report, LvmDevice& d)
@@ -479,7 +583,7 @@ bool LvmDevice::removeVG(Report& report, LvmDevice& d)
             { QStringLiteral("vgremove"),
               QStringLiteral("--force"),
               d.name() });
-    return (deactivated && cmd.run(-1) && cmd.exitCode() == 0);
+    return deactivated && LvmReport::runChange(cmd);
 }
 
 bool LvmDevice::deactivateVG(Report& report, const LvmDevice& d)
@@ -488,7 +592,7 @@ bool LvmDevice::deactivateVG(Report& report, const LvmDevice& d)
             { QStringLiteral("vgchange"),
               QStringLiteral("--activate"), QStringLiteral("n"),
               d.name() });
-    return deactivate.run(-1) && deactivate.exitCode() == 0;
+    return LvmReport::runChange(deactivate);
 }
 
 bool LvmDevice::deactivateLV(Report& report, const Partition& p)
@@ -497,7 +601,7 @@ bool LvmDevice::deactivateLV(Report& report, const Partition& p)
             { QStringLiteral("lvchange"),
               QStringLiteral("--activate"), QStringLiteral("n"),
               p.partitionPath() });
-    return deactivate.run(-1) && deactivate.exitCode() == 0;
+    return LvmReport::runChange(deactivate);
 }
 
 bool LvmDevice::activateVG(Report& report, const LvmDevice& d)
@@ -506,7 +610,7 @@ bool LvmDevice::activateVG(Report& report, const LvmDevice& d)
             { QStringLiteral("vgchange"),
               QStringLiteral("--activate"), QStringLiteral("y"),
               d.name() });
-    return deactivate.run(-1) && deactivate.exitCode() == 0;
+    return LvmReport::runChange(deactivate);
 }
 
 bool LvmDevice::activateLV(const QString& lvPath)
@@ -515,7 +619,7 @@ bool LvmDevice::activateLV(const QString& lvPath)
             { QStringLiteral("lvchange"),
               QStringLiteral("--activate"), QStringLiteral("y"),
               lvPath });
-    return deactivate.run(-1) && deactivate.exitCode() == 0;
+    return LvmReport::runChange(deactivate);
 }
 
 qint64 LvmDevice::peSize() const
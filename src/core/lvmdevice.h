@@ -79,8 +79,9 @@ public:
 
 protected:
     void initPartitions() override;
-    const QList<Partition*> scanPartitions(PartitionTable* pTable) const;
-    Partition* scanPartition(const QString& lvPath, PartitionTable* pTable) const;
+    const QList<Partition*> scanPartitions(PartitionTable* pTable, QList<Partition*>& inactive) const;
+    Partition* scanPartition(const QString& lvPath, PartitionTable* pTable, bool& inactive) const;
+    void probePartition(Partition& p) const;
     qint64 mappedSector(const QString& lvPath, qint64 sector) const override;
 
 public:
@@ -98,6 +99,8 @@ protected:
 
 private:
     static void scanSystemLVM(QList<Device*>& devices);
+    static QList<LvmDevice*> scanVolumeGroups();
+    static void updatePhysicalVolumes(const QList<Device*>& devices);
 };
 
 #endif
@@ -0,0 +1,258 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/lvmreport.h"
+
+#include "util/externalcommand.h"
+
+#include <QFileInfo>
+#include <QStringList>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <sys/stat.h>
+
+/** lvm prints all values as strings, but --reportformat json_std uses numbers. */
+static qint64 toNumber(const QJsonValue& value)
+{
+    bool ok = true;
+    const qint64 number = value.isDouble() ? static_cast<qint64>(value.toDouble()) : value.toString().toLongLong(&ok);
+    return ok ? number : -1;
+}
+
+/** PVs are reported under the name lvm found them with, which may be a symlink. */
+static QString canonicalNode(const QString& deviceNode)
+{
+    const QString canonicalPath = QFileInfo(deviceNode).canonicalFilePath();
+    return canonicalPath.isEmpty() ? deviceNode : canonicalPath;
+}
+
+/** @return the report of this process */
+LvmReport& LvmReport::self()
+{
+    static LvmReport instance;
+    return instance;
+}
+
+/** Drops the snapshot, the next lookup reads a new one. */
+void LvmReport::invalidate()
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Loaded = false;
+}
+
+/** Runs an lvm command that changes metadata or activation and drops the snapshot.
+    @param cmd the command
+    @return true if the command succeeded
+*/
+bool LvmReport::runChange(ExternalCommand& cmd)
+{
+    const bool rval = cmd.run(-1) && cmd.exitCode() == 0;
+    self().invalidate();
+    return rval;
+}
+
+/** lvm writes a metadata backup for every change of a local VG and updates its hints
+    when PVs come or go, activation adds or removes device mapper nodes.
+    @return the modification times of these directories
+*/
+QByteArray LvmReport::changeStamp()
+{
+    static const QStringList paths = {
+        QStringLiteral("/etc/lvm/backup"),
+        QStringLiteral("/etc/lvm/archive"),
+        QStringLiteral("/run/lvm"),
+        QStringLiteral("/run/lvm/hints"),
+        QStringLiteral("/dev/mapper"),
+    };
+
+    QByteArray stamp;
+    for (const auto& path : paths) {
+        struct stat info;
+        if (stat(path.toLocal8Bit().constData(), &info) == 0)
+            stamp += QByteArray::number(static_cast<qint64>(info.st_mtim.tv_sec)) + '.' + QByteArray::number(static_cast<qint64>(info.st_mtim.tv_nsec));
+        stamp += ';';
+    }
+    return stamp;
+}
+
+/** Reads the snapshot if it was never read, was invalidated or lvm changed something since.
+    @return true if the snapshot is usable
+*/
+bool LvmReport::load()
+{
+    const QByteArray stamp = changeStamp();
+    if (m_Loaded && stamp == m_Stamp)
+        return m_Valid;
+
+    m_Loaded = true;
+    m_Stamp = stamp;
+    m_Valid = false;
+    m_VolumeGroups.clear();
+    m_LogicalVolumes.clear();
+    m_PhysicalVolumes.clear();
+
+    // Only ask for the columns that are looked up, and as little as possible for the
+    // segment reports that fullreport always includes.
+    ExternalCommand cmd(QStringLiteral("lvm"),
+            { QStringLiteral("fullreport"),
+              QStringLiteral("--foreign"),
+              QStringLiteral("--readonly"),
+              QStringLiteral("--units"),
+              QStringLiteral("B"),
+              QStringLiteral("--nosuffix"),
+              QStringLiteral("--reportformat"),
+              QStringLiteral("json"),
+              QStringLiteral("--configreport"),
+              QStringLiteral("vg"),
+              QStringLiteral("--options"),
+              QStringLiteral("vg_name,vg_uuid,vg_extent_size,vg_extent_count,vg_free_count"),
+              QStringLiteral("--configreport"),
+              QStringLiteral("lv"),
+              QStringLiteral("--options"),
+              QStringLiteral("lv_path,lv_size,lv_attr"),
+              QStringLiteral("--configreport"),
+              QStringLiteral("pv"),
+              QStringLiteral("--options"),
+              QStringLiteral("pv_name,pv_uuid,pv_used,pe_start,pv_pe_count,pv_pe_alloc_count"),
+              QStringLiteral("--configreport"),
+              QStringLiteral("pvseg"),
+              QStringLiteral("--options"),
+              QStringLiteral("pvseg_start"),
+              QStringLiteral("--configreport"),
+              QStringLiteral("seg"),
+              QStringLiteral("--options"),
+              QStringLiteral("seg_start") },
+            QProcess::ProcessChannelMode::SeparateChannels);
+
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return false;
+
+    // { "report": [ { "vg": [...], "pv": [...], "lv": [...], "pvseg": [...], "seg": [...] }, ... ] }
+    const QJsonDocument document = QJsonDocument::fromJson(cmd.rawOutput());
+    const QJsonValue reports = document.object()[QLatin1String("report")];
+    if (!reports.isArray())
+        return false;
+
+    for (const auto& report : reports.toArray())
+        readReport(report.toObject());
+
+    m_Valid = true;
+    return true;
+}
+
+/** Adds the report of one VG to the snapshot. PVs without a VG come in a report without a VG. */
+void LvmReport::readReport(const QJsonObject& report)
+{
+    const QJsonArray vgs = report[QLatin1String("vg")].toArray();
+    const QJsonObject vgObject = vgs.isEmpty() ? QJsonObject() : vgs.first().toObject();
+    const QString vgName = vgObject[QLatin1String("vg_name")].toString();
+
+    VolumeGroup vg;
+    if (!vgName.isEmpty()) {
+        vg.uuid = vgObject[QLatin1String("vg_uuid")].toString();
+        vg.extentSize = toNumber(vgObject[QLatin1String("vg_extent_size")]);
+        vg.extentCount = toNumber(vgObject[QLatin1String("vg_extent_count")]);
+        vg.freeCount = toNumber(vgObject[QLatin1String("vg_free_count")]);
+    }
+
+    const QJsonArray lvs = report[QLatin1String("lv")].toArray();
+    for (const auto& lv : lvs) {
+        const QJsonObject lvObject = lv.toObject();
+
+        // Hidden LVs, e.g. RAID images or the pool metadata spare, have no path.
+        const QString lvPath = lvObject[QLatin1String("lv_path")].toString();
+        if (lvPath.isEmpty())
+            continue;
+
+        const qint64 lvSize = toNumber(lvObject[QLatin1String("lv_size")]);
+
+        // The fifth character of lv_attr is the state, 'a' for active
+        LogicalVolume logicalVolume;
+        logicalVolume.extents = vg.extentSize > 0 && lvSize >= 0 ? lvSize / vg.extentSize : -1;
+        logicalVolume.active = lvObject[QLatin1String("lv_attr")].toString().mid(4, 1) == QLatin1String("a");
+
+        vg.lvPaths.append(lvPath);
+        m_LogicalVolumes.insert(lvPath, logicalVolume);
+    }
+
+    const QJsonArray pvs = report[QLatin1String("pv")].toArray();
+    for (const auto& pv : pvs) {
+        const QJsonObject pvObject = pv.toObject();
+        const QString pvName = pvObject[QLatin1String("pv_name")].toString();
+        if (pvName.isEmpty())
+            continue;
+
+        PhysicalVolume physicalVolume;
+        physicalVolume.vgName = vgName;
+        physicalVolume.uuid = pvObject[QLatin1String("pv_uuid")].toString();
+        physicalVolume.used = toNumber(pvObject[QLatin1String("pv_used")]);
+        physicalVolume.peStart = toNumber(pvObject[QLatin1String("pe_start")]);
+        physicalVolume.peCount = toNumber(pvObject[QLatin1String("pv_pe_count")]);
+        physicalVolume.peAllocCount = toNumber(pvObject[QLatin1String("pv_pe_alloc_count")]);
+        physicalVolume.extentSize = vgName.isEmpty() ? 0 : vg.extentSize;
+        m_PhysicalVolumes.insert(canonicalNode(pvName), physicalVolume);
+    }
+
+    if (!vgName.isEmpty())
+        m_VolumeGroups.insert(vgName, vg);
+}
+
+/** @param names receives the names of all VGs, sorted like vgs does
+    @return true if the snapshot is usable
+*/
+bool LvmReport::volumeGroupNames(QStringList& names)
+{
+    QMutexLocker locker(&m_Mutex);
+    if (!load())
+        return false;
+
+    names = m_VolumeGroups.keys();
+    return true;
+}
+
+/** @param vgName name of the VG
+    @param vg receives the VG
+    @return true if the VG is in the snapshot
+*/
+bool LvmReport::volumeGroup(const QString& vgName, VolumeGroup& vg)
+{
+    QMutexLocker locker(&m_Mutex);
+    if (!load() || !m_VolumeGroups.contains(vgName))
+        return false;
+
+    vg = m_VolumeGroups.value(vgName);
+    return true;
+}
+
+/** @param lvPath path of the LV as reported by lvm, e.g. /dev/vg/lv
+    @param lv receives the LV
+    @return true if the LV is in the snapshot
+*/
+bool LvmReport::logicalVolume(const QString& lvPath, LogicalVolume& lv)
+{
+    QMutexLocker locker(&m_Mutex);
+    if (!load() || !m_LogicalVolumes.contains(lvPath))
+        return false;
+
+    lv = m_LogicalVolumes.value(lvPath);
+    return true;
+}
+
+/** @param deviceNode device node of the PV, symlinks are resolved
+    @param pv receives the PV
+    @return true if the PV is in the snapshot
+*/
+bool LvmReport::physicalVolume(const QString& deviceNode, PhysicalVolume& pv)
+{
+    QMutexLocker locker(&m_Mutex);
+    const QString node = canonicalNode(deviceNode);
+    if (!load() || !m_PhysicalVolumes.contains(node))
+        return false;
+
+    pv = m_PhysicalVolumes.value(node);
+    return true;
+}
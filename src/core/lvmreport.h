@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_LVMREPORT_H
+#define KPMCORE_LVMREPORT_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+class ExternalCommand;
+
+/** Snapshot of all LVM volume groups, logical and physical volumes.
+
+    A single "lvm fullreport" call describes every VG together with its LVs and PVs,
+    including PVs that are not part of any VG. LvmDevice and lvm2_pv look up what they
+    need here instead of starting vgs, lvs, pvs or lvdisplay once per value.
+
+    Every device scan starts with a new snapshot. Commands that change LVM metadata or
+    activation are run through runChange(), which drops the snapshot. Lookups outside of
+    a scan also read a new snapshot once lvm changed its metadata backups, hints or
+    device mapper nodes, so changes made by other programs are seen, too.
+    If lvm is too old for JSON reports the lookups fail and callers fall back to
+    querying lvm directly.
+
+    The snapshot is shared by the whole process and safe to use from several threads.
+*/
+class LvmReport
+{
+    Q_DISABLE_COPY(LvmReport)
+
+public:
+    struct VolumeGroup
+    {
+        QString uuid;
+        qint64 extentSize = -1;
+        qint64 extentCount = -1;
+        qint64 freeCount = -1;
+        QStringList lvPaths;
+    };
+
+    struct LogicalVolume
+    {
+        qint64 extents = -1;
+        bool active = false;
+    };
+
+    struct PhysicalVolume
+    {
+        QString vgName;
+        QString uuid;
+        qint64 used = -1;
+        qint64 peStart = -1;
+        qint64 peCount = -1;
+        qint64 peAllocCount = -1;
+        qint64 extentSize = -1;
+    };
+
+    static LvmReport& self();
+
+    void invalidate();
+    static bool runChange(ExternalCommand& cmd);
+
+    bool volumeGroupNames(QStringList& names);
+    bool volumeGroup(const QString& vgName, VolumeGroup& vg);
+    bool logicalVolume(const QString& lvPath, LogicalVolume& lv);
+    bool physicalVolume(const QString& deviceNode, PhysicalVolume& pv);
+
+private:
+    LvmReport() = default;
+
+    bool load();
+    static QByteArray changeStamp();
+    void readReport(const QJsonObject& report);
+
+    QMutex m_Mutex;
+    bool m_Loaded = false;
+    bool m_Valid = false;
+    QByteArray m_Stamp;
+
+    QMap<QString, VolumeGroup> m_VolumeGroups;
+    QHash<QString, LogicalVolume> m_LogicalVolumes;
+    QHash<QString, PhysicalVolume> m_PhysicalVolumes;
+};
+
+#endif
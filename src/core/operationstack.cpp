@@ -561,4 +561,84 @@ void OperationStack::sortDevices()
     Q_EMIT devicesChanged();
 }
 
+/** Finds a Device by its device node.
+    @param deviceNode the device node, e.g. /dev/sda
+    @return the Device or nullptr if none could be found
+*/
+Device* OperationStack::findDevice(const QString& deviceNode)
+{
+    QReadLocker lockDevices(&lock());
+
+    for (Device* d : std::as_const(previewDevices()))
+        if (d->deviceNode() == deviceNode)
+            return d;
+
+    return nullptr;
+}
+
+/** @param d the Device to check
+    @return true if a pending Operation targets the Device
+*/
+bool OperationStack::targets(const Device& d) const
+{
+    for (const auto &o : operations())
+        if (o->targets(d))
+            return true;
+
+    return false;
+}
+
+/** Inserts a Device at its sorted position, for devices that were added after the scan.
+    @param d pointer to the Device to insert. Must not be nullptr.
+*/
+void OperationStack::insertDevice(Device* d)
+{
+    Q_ASSERT(d);
+
+    QWriteLocker lockDevices(&lock());
+
+    auto it = previewDevices().begin();
+    while (it != previewDevices().end() && deviceLessThan(*it, d))
+        ++it;
+    previewDevices().insert(it, d);
+
+    Q_EMIT deviceAdded(d);
+}
+
+/** Removes a Device that disappeared from the system. The Device is deleted once control returns to the event loop.
+    @param d pointer to the Device to remove. Must not be nullptr.
+*/
+void OperationStack::removeDevice(Device* d)
+{
+    Q_ASSERT(d);
+
+    QWriteLocker lockDevices(&lock());
+
+    const QString deviceNode = d->deviceNode();
+    previewDevices().removeAll(d);
+    d->deleteLater();
+
+    Q_EMIT deviceRemoved(deviceNode);
+}
+
+/** Replaces a Device with a new scan of it, keeping its position. The old Device is deleted once control returns to the event loop.
+    @param oldDevice pointer to the Device to replace. Must not be nullptr.
+    @param newDevice pointer to the new Device. Must not be nullptr.
+*/
+void OperationStack::replaceDevice(Device* oldDevice, Device* newDevice)
+{
+    Q_ASSERT(oldDevice && newDevice);
+
+    QWriteLocker lockDevices(&lock());
+
+    const int index = previewDevices().indexOf(oldDevice);
+    if (index < 0)
+        previewDevices().append(newDevice);
+    else
+        previewDevices()[index] = newDevice;
+    oldDevice->deleteLater();
+
+    Q_EMIT deviceChanged(newDevice);
+}
+
 #include "moc_operationstack.cpp"
@@ -50,6 +50,9 @@ public:
 Q_SIGNALS:
     void operationsChanged();
     void devicesChanged();
+    void deviceAdded(Device* d);
+    void deviceRemoved(const QString& deviceNode);
+    void deviceChanged(Device* d);
 
 public:
     void push(Operation* o);
@@ -75,6 +78,8 @@ public:
     }
 
     Device* findDeviceForPartition(const Partition* p);
+    Device* findDevice(const QString& deviceNode);
+    bool targets(const Device& d) const;
 
     QReadWriteLock& lock() {
         return m_Lock;
@@ -84,6 +89,9 @@ protected:
     void clearDevices();
     void addDevice(Device* d);
     void sortDevices();
+    void insertDevice(Device* d);
+    void removeDevice(Device* d);
+    void replaceDevice(Device* oldDevice, Device* newDevice);
 
     bool mergeNewOperation(Operation*& currentOp, Operation*& pushedOp);
     bool mergeCopyOperation(Operation*& currentOp, Operation*& pushedOp);
@@ -20,6 +20,7 @@
 #include "util/report.h"
 
 #include <QFile>
+#include <QMutex>
 #include <QRegularExpression>
 #include <QStorageInfo>
 #include <QString>
@@ -28,6 +29,10 @@
 
 #include <KLocalizedString>
 
+// Probes of all Partitions run one at a time, they mostly wait for the helper anyway. The
+// mutex is recursive because a probe uses the accessors of the Partition it probes.
+static QRecursiveMutex probeMutex;
+
 /** Creates a new Partition object.
     @param parent the Partition's parent. May be another Partition (for logicals) or a PartitionTable. Must not be nullptr.
     @param device the Device this Partition is on.
@@ -123,6 +128,7 @@ Partition& Partition::operator=(const Partition& other)
         m_Children.append(p);
     }
 
+    setProbe(nullptr);
     m_Number = other.m_Number;
     m_FileSystem = FileSystemFactory::create(other.fileSystem());
     m_Roles = other.m_Roles;
@@ -373,6 +379,35 @@ void Partition::setFileSystem(FileSystem* fs)
     m_FileSystem = fs;
 }
 
+/** Defers reading the FileSystem details until they are first asked for.
+
+    Until then the Partition has a placeholder FileSystem. The probe runs once, from
+    ensureProbed(), which fileSystem(), roles(), label(), mountPoint() and isMounted()
+    call. It replaces the FileSystem and updates roles and mount status. Probes run
+    external commands, so whichever thread first asks blocks until they are done, and
+    other threads asking in the meantime wait for it.
+    @param probe function that reads the details, or nullptr to cancel a pending probe
+*/
+void Partition::setProbe(const Probe& probe)
+{
+    QMutexLocker locker(&probeMutex);
+    m_Probe = probe;
+    m_Probed.store(!probe, std::memory_order_release);
+}
+
+void Partition::probe() const
+{
+    QMutexLocker locker(&probeMutex);
+    if (!m_Probe)
+        return;
+
+    // Reset first, the probe itself looks at the Partition
+    const Probe pending = std::move(m_Probe);
+    m_Probe = nullptr;
+    pending(const_cast<Partition&>(*this));
+    m_Probed.store(true, std::memory_order_release);
+}
+
 void Partition::move(qint64 newStartSector)
 {
     const qint64 savedLength = length();
@@ -21,6 +21,9 @@
 #include <QtGlobal>
 #include <QPointer>
 
+#include <atomic>
+#include <functional>
+
 class Device;
 class OperationStack;
 class CoreBackendPartitionTable;
@@ -67,6 +70,9 @@ class LIBKPMCORE_EXPORT Partition : public PartitionNode
 {
 
 public:
+    /** Reads the details of a Partition's FileSystem, see setProbe() */
+    typedef std::function<void(Partition&)> Probe;
+
     /** A Partition state -- where did it come from? */
     enum State {
         None,      /**< exists on disk */
@@ -118,6 +124,7 @@ public:
         return m_PartitionPath;    /**< @return the Partition's path, e.g. /dev/sdd1 */
     }
     const QString& label() const {
+        ensureProbed();
         return m_Label;    /**< @return the GPT Partition label */
     }
     const QString& type() const {
@@ -165,10 +172,12 @@ public:
     QString deviceNode() const;
 
     const PartitionRole& roles() const {
+        ensureProbed();
         return m_Roles;    /**< @return the Partition's role(s) */
     }
 
     const QString& mountPoint() const {
+        ensureProbed();
         return m_MountPoint;    /**< @return the Partition's mount point */
     }
 
@@ -179,14 +188,24 @@ public:
         return m_AvailableFlags;    /**< @return the flags available for this Partition */
     }
     bool isMounted() const {
+        ensureProbed();
         return m_IsMounted;    /**< @return true if Partition is mounted */
     }
     FileSystem& fileSystem() {
+        ensureProbed();
         return *m_FileSystem;    /**< @return the Partition's FileSystem */
     }
     const FileSystem& fileSystem() const {
+        ensureProbed();
         return *m_FileSystem;    /**< @return the Partition's FileSystem */
     }
+    bool isProbed() const {
+        return m_Probed.load(std::memory_order_acquire);    /**< @return true if the FileSystem details have been read */
+    }
+    void ensureProbed() const {
+        if (!isProbed())
+            probe();    /**< Runs a pending probe, see setProbe(). May block on external commands. */
+    }
     State state() const {
         return m_State;    /**< @return the Partition's state */
     }
@@ -258,8 +277,11 @@ public:
         m_State = s;
     }
     void deleteFileSystem();
+    void setProbe(const Probe& probe);
 
 private:
+    void probe() const;
+
     void setNumber(qint32 n) {
         m_Number = n;
     }
@@ -268,6 +290,8 @@ private:
     Partitions m_Children;
     QPointer< PartitionNode > m_Parent = nullptr;
     FileSystem* m_FileSystem = nullptr;
+    mutable Probe m_Probe;
+    mutable std::atomic<bool> m_Probed{true};
     PartitionRole m_Roles;
     qint64 m_FirstSector = 0;
     qint64 m_LastSector = 0;
@@ -14,7 +14,9 @@
 #include "fs/filesystemfactory.h"
 #include "util/externalcommand.h"
 
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <KLocalizedString>
 #include <QFile>
@@ -35,6 +37,20 @@ public:
     SoftwareRAID::Status m_status;
 };
 
+/** Everything KPMcore needs from the "mdadm --detail" output of an array */
+struct SoftwareRAID::Detail
+{
+    bool valid = false;
+    qint32 raidLevel = -1;
+    qint64 chunkSize = -1;
+    qint64 arraySize = -1;
+    QString uuid;
+    QStringList devicePathList;
+};
+
+QHash<QString, SoftwareRAID::Detail> SoftwareRAID::s_Details;
+QMutex SoftwareRAID::s_DetailMutex;
+
 SoftwareRAID::SoftwareRAID(const QString& name, SoftwareRAID::Status status, const QString& iconName)
     : VolumeManagerDevice(std::make_shared<SoftwareRAIDPrivate>(),
                           name,
@@ -157,6 +173,9 @@ void SoftwareRAID::setStatus(SoftwareRAID::Status status)
 
 void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
 {
+    // Arrays may have been assembled, stopped or changed since the last scan
+    refreshDetail();
+
     QStringList availableInConf;
 
     // TODO: Support custom config files.
@@ -184,6 +203,16 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
         mdstat.close();
 
         QRegularExpression re(QStringLiteral("md([\\/\\w]+)\\s+:\\s+([\\w]+)"));
+
+        // Every array below and every array in the configuration needs "mdadm --detail"
+        QStringList detailPaths;
+        for (const QString& path : std::as_const(availableInConf))
+            detailPaths << QStringLiteral("/dev/") + path;
+        QRegularExpressionMatchIterator arrays = re.globalMatch(content);
+        while (arrays.hasNext())
+            detailPaths << QStringLiteral("/dev/md") + arrays.next().captured(1).trimmed();
+        fetchDetails(detailPaths);
+
         QRegularExpressionMatchIterator i  = re.globalMatch(content);
         while (i.hasNext()) {
             QRegularExpressionMatch reMatch = i.next();
@@ -231,76 +260,30 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
 
 qint32 SoftwareRAID::getRaidLevel(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Raid Level :\\s+\\w+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong();
-    }
-
-    return -1;
+    return detail(path).raidLevel;
 }
 
 qint64 SoftwareRAID::getChunkSize(const QString &path)
 {
-    if (getRaidLevel(path) == 1) {
-        QStringList devices = getDevicePathList(path);
-
-        if (!devices.isEmpty()) {
-            QString device = devices[0];
-            // Look sector size for the first device/partition on the list, as RAID 1 is composed by mirrored devices
-            ExternalCommand sectorSize(QStringLiteral("blockdev"), { QStringLiteral("--getss"), device });
-
-            if (sectorSize.run(-1) && sectorSize.exitCode() == 0) {
-                int sectors = sectorSize.output().trimmed().toLongLong();
-                return sectors;
-            }
-        }
-    }
-    else {
-        QString output = getDetail(path);
-        if (!output.isEmpty()) {
-            QRegularExpression re(QStringLiteral("Chunk Size :\\s+(\\d+)"));
-            QRegularExpressionMatch reMatch = re.match(output);
-            if (reMatch.hasMatch())
-                return reMatch.captured(1).toLongLong();
-        }
-    }
-    return -1;
-
+    return detail(path).chunkSize;
 }
 
 qint64 SoftwareRAID::getTotalChunk(const QString &path)
 {
-    return getArraySize(path) / getChunkSize(path);
+    const Detail raid = detail(path);
+    return raid.arraySize / raid.chunkSize;
 }
 
 qint64 SoftwareRAID::getArraySize(const QString &path)
 {
-    QString output = getDetail(path);
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Array Size :\\s+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong() * 1024;
-    }
-    return -1;
-
+    return detail(path).arraySize;
 }
 
 QString SoftwareRAID::getUUID(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("UUID :\\s+([\\w:]+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-
-        if (reMatch.hasMatch())
-            return reMatch.captured(1);
-    }
+    const QString uuid = detail(path).uuid;
+    if (!uuid.isEmpty())
+        return uuid;
 
     // If UUID was not found in detail output, it should be searched in config file
 
@@ -341,29 +324,12 @@ QString SoftwareRAID::getUUID(const QString &path)
 
 QStringList SoftwareRAID::getDevicePathList(const QString &path)
 {
-    QStringList result;
-
-    QString detail = getDetail(path);
-
-    if (!detail.isEmpty()) {
-        QRegularExpression re(QStringLiteral("\\s+\\/dev\\/(\\w+)"));
-        QRegularExpressionMatchIterator i = re.globalMatch(detail);
-
-        while (i.hasNext()) {
-            QRegularExpressionMatch match = i.next();
-
-            QString device = QStringLiteral("/dev/") + match.captured(1);
-            if (device != path)
-                result << device;
-        }
-    }
-
-    return result;
+    return detail(path).devicePathList;
 }
 
 bool SoftwareRAID::isRaidPath(const QString &path)
 {
-    return !getDetail(path).isEmpty();
+    return detail(path).valid;
 }
 
 bool SoftwareRAID::createSoftwareRAID(Report &report,
@@ -396,7 +362,9 @@ bool SoftwareRAID::assembleSoftwareRAID(const QString& deviceNode)
     ExternalCommand cmd(QStringLiteral("mdadm"),
                         { QStringLiteral("--assemble"), QStringLiteral("--scan"), deviceNode });
 
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool success = cmd.run(-1) && cmd.exitCode() == 0;
+    refreshDetail(deviceNode);
+    return success;
 }
 
 bool SoftwareRAID::stopSoftwareRAID(const QString& deviceNode)
@@ -407,7 +375,9 @@ bool SoftwareRAID::stopSoftwareRAID(const QString& deviceNode)
     ExternalCommand cmd(QStringLiteral("mdadm"),
                         { QStringLiteral("--manage"), QStringLiteral("--stop"), deviceNode });
 
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool success = cmd.run(-1) && cmd.exitCode() == 0;
+    refreshDetail(deviceNode);
+    return success;
 }
 
 bool SoftwareRAID::reassembleSoftwareRAID(const QString &deviceNode)
@@ -462,6 +432,129 @@ QString SoftwareRAID::getDetail(const QString &path)
     return (cmd.run(-1) && cmd.exitCode() == 0) ? cmd.output() : QString();
 }
 
+/** Runs "mdadm --detail" for an array once and keeps the parsed result until refreshDetail() is called.
+ *
+ * @param path device node of the array
+ * @return the details of the array, not valid if mdadm does not know the array
+ */
+SoftwareRAID::Detail SoftwareRAID::detail(const QString &path)
+{
+    QMutexLocker locker(&s_DetailMutex);
+
+    const auto it = s_Details.constFind(path);
+    if (it != s_Details.cend())
+        return it.value();
+
+    const Detail result = parseDetail(path, getDetail(path));
+    s_Details.insert(path, result);
+    return result;
+}
+
+/** @param path device node of the array
+ *  @param output what "mdadm --detail" printed for it, empty if it failed
+ *  @return the details of the array, not valid if the output is empty
+ */
+SoftwareRAID::Detail SoftwareRAID::parseDetail(const QString &path, const QString &output)
+{
+    Detail result;
+
+    if (!output.isEmpty()) {
+        result.valid = true;
+
+        QRegularExpression reLevel(QStringLiteral("Raid Level :\\s+\\w+(\\d+)"));
+        QRegularExpressionMatch reMatch = reLevel.match(output);
+        if (reMatch.hasMatch())
+            result.raidLevel = reMatch.captured(1).toLongLong();
+
+        QRegularExpression reArraySize(QStringLiteral("Array Size :\\s+(\\d+)"));
+        reMatch = reArraySize.match(output);
+        if (reMatch.hasMatch())
+            result.arraySize = reMatch.captured(1).toLongLong() * 1024;
+
+        QRegularExpression reUUID(QStringLiteral("UUID :\\s+([\\w:]+)"));
+        reMatch = reUUID.match(output);
+        if (reMatch.hasMatch())
+            result.uuid = reMatch.captured(1);
+
+        QRegularExpression reDevice(QStringLiteral("\\s+\\/dev\\/(\\w+)"));
+        QRegularExpressionMatchIterator i = reDevice.globalMatch(output);
+        while (i.hasNext()) {
+            QRegularExpressionMatch match = i.next();
+
+            QString device = QStringLiteral("/dev/") + match.captured(1);
+            if (device != path)
+                result.devicePathList << device;
+        }
+
+        if (result.raidLevel == 1) {
+            // Look sector size for the first device/partition on the list, as RAID 1 is composed by mirrored devices
+            if (!result.devicePathList.isEmpty()) {
+                ExternalCommand sectorSize(QStringLiteral("blockdev"), { QStringLiteral("--getss"), result.devicePathList[0] });
+
+                if (sectorSize.run(-1) && sectorSize.exitCode() == 0)
+                    result.chunkSize = sectorSize.output().trimmed().toLongLong();
+            }
+        }
+        else {
+            QRegularExpression reChunkSize(QStringLiteral("Chunk Size :\\s+(\\d+)"));
+            reMatch = reChunkSize.match(output);
+            if (reMatch.hasMatch())
+                result.chunkSize = reMatch.captured(1).toLongLong();
+        }
+    }
+
+    return result;
+}
+
+/** Runs "mdadm --detail" for all given arrays that are not cached yet, with a single call to the helper.
+ *
+ * Arrays that mdadm fails on are left out of the cache, detail() tries them again one by one.
+ * @param paths device nodes of the arrays
+ */
+void SoftwareRAID::fetchDetails(const QStringList &paths)
+{
+    QStringList missing;
+    {
+        QMutexLocker locker(&s_DetailMutex);
+        for (const QString& path : paths)
+            if (!s_Details.contains(path) && !missing.contains(path))
+                missing << path;
+    }
+
+    if (missing.size() < 2)
+        return;
+
+    std::vector<std::unique_ptr<ExternalCommand>> commands;
+    QList<ExternalCommand*> batch;
+    for (const QString& path : std::as_const(missing)) {
+        commands.push_back(std::make_unique<ExternalCommand>(QStringLiteral("mdadm"),
+                                                             QStringList{ QStringLiteral("--misc"), QStringLiteral("--detail"), path }));
+        batch << commands.back().get();
+    }
+
+    ExternalCommand::runAll(batch);
+
+    QMutexLocker locker(&s_DetailMutex);
+    for (int i = 0; i < missing.size(); ++i)
+        if (batch[i]->exitCode() == 0 && !s_Details.contains(missing[i]))
+            s_Details.insert(missing[i], parseDetail(missing[i], batch[i]->output()));
+}
+
+/** Drops the cached "mdadm --detail" of an array, so that it is read again when next needed.
+ *
+ * Call this after anything that changes the array, e.g. assembling or stopping it.
+ * @param path device node of the array, or an empty string for all arrays
+ */
+void SoftwareRAID::refreshDetail(const QString &path)
+{
+    QMutexLocker locker(&s_DetailMutex);
+
+    if (path.isEmpty())
+        s_Details.clear();
+    else
+        s_Details.remove(path);
+}
+
 QString SoftwareRAID::getRAIDConfiguration(const QString &configurationPath)
 {
     QFile config(configurationPath);
@@ -11,6 +11,9 @@
 #include "util/libpartitionmanagerexport.h"
 #include "util/report.h"
 
+#include <QHash>
+#include <QMutex>
+
 class LIBKPMCORE_EXPORT SoftwareRAID : public VolumeManagerDevice
 {
     Q_DISABLE_COPY(SoftwareRAID)
@@ -78,6 +81,8 @@ public:
 
     static bool isRaidMember(const QString& path);
 
+    static void refreshDetail(const QString& path = QString());
+
 protected:
     void initPartitions() override;
 
@@ -86,9 +91,17 @@ protected:
 private:
     static void scanSoftwareRAID(QList<Device*>& devices);
 
+    struct Detail;
+
     static QString getDetail(const QString& path);
+    static Detail detail(const QString& path);
+    static Detail parseDetail(const QString& path, const QString& output);
+    static void fetchDetails(const QStringList& paths);
 
     static QString getRAIDConfiguration(const QString& configurationPath);
+
+    static QHash<QString, Detail> s_Details;
+    static QMutex s_DetailMutex;
 };
 
 #endif // SOFTWARERAID_H
@@ -11,9 +11,13 @@
 
 #include <utility>
 
+#include <QHash>
 #include <QJsonObject>
 #include <QMap>
+#include <QMutex>
+#include <QPair>
 #include <QRegularExpression>
+#include <QStringList>
 #include <QVariant>
 #include <QVector>
 
@@ -610,28 +614,95 @@ static const QVector<SmartAttributeParsedData::SmartQuirkDataBase> quirkDatabase
     return quirkDb;
 }
 
-static SmartQuirk getQuirk(QString model, QString firmware)
+/** The quirk database compiled once for the whole process.
+
+    All model patterns are merged into one alternation, so finding the first entry whose
+    model matches takes a single regex match instead of one per entry. Every alternative
+    is wrapped in a group, and the index of that group tells which entry matched. All
+    model patterns start with ^, so the alternation finds the first matching entry.
+*/
+class SmartQuirkMatcher
 {
-    const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
+public:
+    SmartQuirkMatcher()
+    {
+        const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
+
+        QStringList alternatives;
+        int group = 1;
+        for (const SmartAttributeParsedData::SmartQuirkDataBase &item : db) {
+            Entry entry;
+            entry.model = QRegularExpression(item.model);
+            entry.firmware = QRegularExpression(item.firmware);
+            entry.hasModel = !item.model.isEmpty();
+            entry.hasFirmware = !item.firmware.isEmpty();
+            entry.quirk = item.quirk;
+            entry.group = group;
+            m_Entries.append(entry);
+
+            alternatives << QStringLiteral("(") + item.model + QStringLiteral(")");
+            group += 1 + entry.model.captureCount();
+        }
 
-    QRegularExpression modelRegex;
-    QRegularExpression firmwareRegex;
+        m_AnyModel = QRegularExpression(alternatives.join(QLatin1Char('|')));
+        m_AnyModel.optimize();
+    }
 
-    for (const SmartAttributeParsedData::SmartQuirkDataBase &item : std::as_const(db)) {
-        if (!item.model.isEmpty()) {
-            modelRegex.setPattern(item.model);
-            QRegularExpressionMatch match = modelRegex.match(model);
-            if (!match.hasMatch())
+    /** @return the quirk of the first entry that matches both model and firmware */
+    SmartQuirk match(const QString &model, const QString &firmware) const
+    {
+        const QRegularExpressionMatch anyMatch = m_AnyModel.match(model);
+        if (!anyMatch.hasMatch())
+            return SmartQuirk::None;
+
+        int first = 0;
+        while (first < m_Entries.size() && anyMatch.capturedStart(m_Entries[first].group) < 0)
+            ++first;
+
+        // Usually the first entry for the model also matches the firmware. If not, a later
+        // entry for the same model may, so check those one by one.
+        for (int i = first; i < m_Entries.size(); ++i) {
+            const Entry &entry = m_Entries[i];
+            if (entry.hasModel && i != first && !entry.model.match(model).hasMatch())
                 continue;
-        }
-        if (!item.firmware.isEmpty()) {
-            firmwareRegex.setPattern(item.firmware);
-            QRegularExpressionMatch match = firmwareRegex.match(firmware);
-            if (!match.hasMatch())
+            if (entry.hasFirmware && !entry.firmware.match(firmware).hasMatch())
                 continue;
+            return entry.quirk;
         }
-        return item.quirk;
+
+        return SmartQuirk::None;
     }
 
-    return SmartQuirk::None;
+private:
+    struct Entry {
+        QRegularExpression model;
+        QRegularExpression firmware;
+        bool hasModel;
+        bool hasFirmware;
+        SmartQuirk quirk;
+        int group;
+    };
+
+    QVector<Entry> m_Entries;
+    QRegularExpression m_AnyModel;
+};
+
+static SmartQuirk getQuirk(QString model, QString firmware)
+{
+    static const SmartQuirkMatcher matcher;
+
+    // All attributes of a disk, and all disks of the same kind, share model and firmware
+    static QMutex cacheMutex;
+    static QHash<QPair<QString, QString>, SmartQuirk> cache;
+
+    const QPair<QString, QString> key(model, firmware);
+
+    QMutexLocker locker(&cacheMutex);
+    const auto it = cache.constFind(key);
+    if (it != cache.cend())
+        return it.value();
+
+    const SmartQuirk quirk = matcher.match(model, firmware);
+    cache.insert(key, quirk);
+    return quirk;
 }
@@ -0,0 +1,350 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/smarthistory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <sys/file.h>
+
+// The file starts with this, bump the version when the format changes
+static const char historyMagic[] = { 'K', 'P', 'M', 'H' };
+constexpr char historyVersion = 1;
+constexpr qint64 headerSize = sizeof(historyMagic) + 1;
+
+static QMutex historyMutex;
+static bool recording = false;
+static QString historyDirectory;
+
+/** What a writer needs to know about the end of a history file */
+struct HistoryState
+{
+    qint64 size = 0;       // of the file up to the last complete record
+    qint64 time = 0;
+    SmartHistory::Values values;
+};
+
+// States of the files this process appended to, so that appending does not decode the whole file
+static QHash<QString, HistoryState> historyStates;
+
+static void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static void writeSigned(QByteArray& out, qint64 value)
+{
+    writeVarint(out, (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63));
+}
+
+static bool readVarint(const uchar*& pos, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        const uchar byte = *pos++;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool readSigned(const uchar*& pos, const uchar* end, qint64& value)
+{
+    quint64 zigzag;
+    if (!readVarint(pos, end, zigzag))
+        return false;
+
+    value = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+    return true;
+}
+
+static QString historyPath()
+{
+    if (historyDirectory.isEmpty())
+        return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kpmcore/smart-history");
+
+    return historyDirectory;
+}
+
+static QString historyFile(const QString& serial)
+{
+    // Serial numbers may contain anything. Percent encoding keeps different serials apart
+    // and leaves letters, digits, '-' and '_', the dots of "." and ".." are encoded, too.
+    const QByteArray name = QUrl::toPercentEncoding(serial, QByteArray(), QByteArrayLiteral(".~"));
+
+    return historyPath() + QLatin1Char('/') + QString::fromLatin1(name);
+}
+
+/** Decodes the records of a history file.
+
+    Record: payload length, payload. Payload: time difference, number of changed values,
+    then series and value difference of each. Lengths, counts and series are unsigned, the
+    differences zigzag encoded variable length integers.
+
+    @param data the file contents after the header
+    @param size size of data
+    @param state receives the time and values after the last complete record, and its end
+    @param record if set, called after every record with the current state
+*/
+static void decode(const uchar* data, qint64 size, HistoryState& state, const std::function<void(const HistoryState&)>& record = nullptr)
+{
+    const uchar* pos = data;
+    const uchar* end = data + size;
+    state.size = headerSize;
+
+    while (pos < end) {
+        quint64 length;
+        if (!readVarint(pos, end, length) || length > static_cast<quint64>(end - pos))
+            return; // a record that was not written completely
+
+        const uchar* recordEnd = pos + length;
+        qint64 timeDelta;
+        quint64 count;
+        if (!readSigned(pos, recordEnd, timeDelta) || !readVarint(pos, recordEnd, count))
+            return;
+
+        HistoryState next = state;
+        next.time += timeDelta;
+        for (quint64 i = 0; i < count; ++i) {
+            quint64 series;
+            qint64 delta;
+            if (!readVarint(pos, recordEnd, series) || !readSigned(pos, recordEnd, delta))
+                return;
+            next.values[static_cast<quint32>(series)] += delta;
+        }
+
+        pos = recordEnd;
+        next.size = headerSize + (pos - data);
+        state = next;
+
+        if (record)
+            record(state);
+    }
+}
+
+/** Reads the history of a disk.
+    @param serial serial number of the disk
+*/
+SmartHistory::SmartHistory(const QString& serial) :
+    m_Serial(serial)
+{
+    QFile file(fileName(serial));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    // Other processes may append at the same time, the lock is released when the file is closed
+    flock(file.handle(), LOCK_SH);
+    if (file.size() < headerSize)
+        return;
+
+    uchar* data = file.map(0, file.size());
+    if (!data || memcmp(data, historyMagic, sizeof(historyMagic)) != 0 || data[sizeof(historyMagic)] != historyVersion)
+        return;
+
+    HistoryState state;
+    decode(data + headerSize, file.size() - headerSize, state, [this] (const HistoryState& current) {
+        for (auto it = current.values.cbegin(); it != current.values.cend(); ++it)
+            m_Samples[it.key()].append({ current.time, it.value() });
+    });
+
+    file.unmap(data);
+    m_Valid = true;
+}
+
+/** @return the recorded series, sorted */
+QList<quint32> SmartHistory::series() const
+{
+    QList<quint32> result = m_Samples.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/** @param series a SMART attribute id or a Series
+    @param from start of the window in seconds since the epoch
+    @param to end of the window in seconds since the epoch, inclusive
+    @return the samples of the series in the window, oldest first
+*/
+QVector<SmartHistory::Sample> SmartHistory::samples(quint32 series, qint64 from, qint64 to) const
+{
+    QVector<Sample> result;
+    for (const Sample& sample : m_Samples.value(series))
+        if (sample.time >= from && sample.time <= to)
+            result.append(sample);
+
+    return result;
+}
+
+/** @param series a SMART attribute id or a Series
+    @param from start of the window in seconds since the epoch
+    @param to end of the window in seconds since the epoch, inclusive
+    @param min receives the smallest value in the window
+    @param max receives the largest value in the window
+    @return true if there are samples in the window
+*/
+bool SmartHistory::range(quint32 series, qint64 from, qint64 to, qint64& min, qint64& max) const
+{
+    const QVector<Sample> window = samples(series, from, to);
+    if (window.isEmpty())
+        return false;
+
+    const auto minMax = std::minmax_element(window.cbegin(), window.cend(), [] (const Sample& a, const Sample& b) {
+        return a.value < b.value;
+    });
+    min = minMax.first->value;
+    max = minMax.second->value;
+    return true;
+}
+
+/** @param series a SMART attribute id or a Series
+    @param from start of the window in seconds since the epoch
+    @param to end of the window in seconds since the epoch, inclusive
+    @return change of the value per day between the first and last sample in the window,
+            0 if the window has fewer than two samples
+*/
+double SmartHistory::rateOfChange(quint32 series, qint64 from, qint64 to) const
+{
+    const QVector<Sample> window = samples(series, from, to);
+    if (window.size() < 2 || window.last().time == window.first().time)
+        return 0;
+
+    constexpr double secondsPerDay = 24 * 60 * 60;
+    return (window.last().value - window.first().value) * secondsPerDay / (window.last().time - window.first().time);
+}
+
+/** Appends a sample to the history of a disk.
+    @param serial serial number of the disk
+    @param time time of the sample in seconds since the epoch
+    @param values the values of the sample, series that are left out keep their last value
+    @return true on success
+*/
+bool SmartHistory::append(const QString& serial, qint64 time, const Values& values)
+{
+    QMutexLocker locker(&historyMutex);
+
+    const QString path = historyFile(serial);
+    if (serial.isEmpty() || !QDir().mkpath(historyPath()))
+        return false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    // Several processes, e.g. a partition manager and an installer, may record the same disk.
+    // Nobody else writes while this one checks, repairs and appends to the end of the file.
+    if (flock(file.handle(), LOCK_EX) != 0)
+        return false;
+
+    if (file.size() == 0) {
+        file.write(historyMagic, sizeof(historyMagic));
+        file.write(&historyVersion, 1);
+        historyStates.insert(path, HistoryState());
+        historyStates[path].size = headerSize;
+    } else {
+        // Never append to something that is not a history, whatever the cached state says
+        char header[headerSize];
+        if (file.read(header, headerSize) != headerSize || memcmp(header, historyMagic, sizeof(historyMagic)) != 0 || header[sizeof(historyMagic)] != historyVersion)
+            return false;
+    }
+
+    auto it = historyStates.find(path);
+    if (it == historyStates.end() || it->size != file.size()) {
+        // Written by another process, or never seen before
+        if (file.size() < headerSize)
+            return false;
+
+        uchar* data = file.map(0, file.size());
+        if (!data || memcmp(data, historyMagic, sizeof(historyMagic)) != 0 || data[sizeof(historyMagic)] != historyVersion)
+            return false;
+
+        HistoryState state;
+        decode(data + headerSize, file.size() - headerSize, state);
+        file.unmap(data);
+        it = historyStates.insert(path, state);
+    }
+
+    // Drop what is left of a record that was cut short
+    if (file.size() > it->size && !file.resize(it->size))
+        return false;
+
+    QList<quint32> changed;
+    for (auto value = values.cbegin(); value != values.cend(); ++value)
+        if (!it->values.contains(value.key()) || it->values.value(value.key()) != value.value())
+            changed.append(value.key());
+    std::sort(changed.begin(), changed.end());
+
+    QByteArray payload;
+    writeSigned(payload, time - it->time);
+    writeVarint(payload, changed.size());
+    for (const quint32 series : std::as_const(changed)) {
+        writeVarint(payload, series);
+        writeSigned(payload, values.value(series) - it->values.value(series));
+        it->values[series] = values.value(series);
+    }
+
+    QByteArray record;
+    writeVarint(record, payload.size());
+    record += payload;
+
+    if (!file.seek(it->size) || file.write(record) != record.size() || !file.flush()) {
+        historyStates.remove(path);
+        return false;
+    }
+
+    it->time = time;
+    it->size += record.size();
+    return true;
+}
+
+/** @return true if collected SMART data is added to the history of the disk */
+bool SmartHistory::isRecording()
+{
+    QMutexLocker locker(&historyMutex);
+    return recording;
+}
+
+/** @param enabled true to add collected SMART data to the history of the disk, off by default */
+void SmartHistory::setRecording(bool enabled)
+{
+    QMutexLocker locker(&historyMutex);
+    recording = enabled;
+}
+
+/** @return the directory the history files are kept in */
+QString SmartHistory::directory()
+{
+    QMutexLocker locker(&historyMutex);
+    return historyPath();
+}
+
+/** @param path the directory to keep the history files in, an empty path restores the default */
+void SmartHistory::setDirectory(const QString& path)
+{
+    QMutexLocker locker(&historyMutex);
+    historyDirectory = path;
+}
+
+/** @param serial serial number of a disk
+    @return path of the history file of the disk
+*/
+QString SmartHistory::fileName(const QString& serial)
+{
+    QMutexLocker locker(&historyMutex);
+    return historyFile(serial);
+}
@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SMARTHISTORY_H
+#define KPMCORE_SMARTHISTORY_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <limits>
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+/** Recorded SMART values of one disk.
+
+    While recording is enabled, every collection of SMART data appends the raw values of
+    all attributes and the temperature, bad sector, power on and power cycle counts to a
+    file named after the serial number of the disk. A record only holds the values that
+    changed, as differences to the previous record in variable length integers, so a
+    sample of a healthy disk takes a few bytes and months of history fit in little space.
+    Writers lock the file, so several processes can record the same disk.
+
+    A SmartHistory maps the file of a disk into memory and decodes it once, after that
+    the queries do not touch the file.
+*/
+class LIBKPMCORE_EXPORT SmartHistory
+{
+public:
+    /** Series that are not SMART attributes. The series 1 to 255 are the raw values of the attributes with that id. */
+    enum Series : quint32 {
+        Temperature = 256, /**< temperature in millikelvin */
+        BadSectors,        /**< number of bad sectors */
+        PoweredOn,         /**< powered on time in milliseconds */
+        PowerCycles        /**< number of power cycles */
+    };
+
+    struct Sample {
+        qint64 time;  /**< seconds since the epoch */
+        qint64 value;
+    };
+
+    typedef QHash<quint32, qint64> Values;
+
+    explicit SmartHistory(const QString& serial);
+
+    bool isValid() const {
+        return m_Valid; /**< @return true if there is a history for the disk */
+    }
+    const QString& serial() const {
+        return m_Serial; /**< @return the serial number of the disk */
+    }
+
+    QList<quint32> series() const;
+    QVector<Sample> samples(quint32 series, qint64 from = 0, qint64 to = std::numeric_limits<qint64>::max()) const;
+    bool range(quint32 series, qint64 from, qint64 to, qint64& min, qint64& max) const;
+    double rateOfChange(quint32 series, qint64 from = 0, qint64 to = std::numeric_limits<qint64>::max()) const;
+
+    static bool append(const QString& serial, qint64 time, const Values& values);
+
+    static bool isRecording();
+    static void setRecording(bool enabled);
+    static QString directory();
+    static void setDirectory(const QString& path);
+    static QString fileName(const QString& serial);
+
+private:
+    QString m_Serial;
+    bool m_Valid = false;
+    QHash<quint32, QVector<Sample>> m_Samples;
+};
+
+#endif
@@ -11,21 +11,44 @@
 
 #include "core/smartstatus.h"
 
+#include "core/smarthistory.h"
 #include "core/smartparser.h"
 #include "core/smartdiskinformation.h"
 #include "core/smartattributeparseddata.h"
 
 #include <KLocalizedString>
 
+#include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
 
+#include <chrono>
 #include <errno.h>
 #include <utility>
 
+// smartctl mostly waits for the disks, so all disks of a typical system are queried at once
+constexpr int maxSmartThreads = 8;
+
+/** SMART data collected for a disk, shared by all SmartStatus objects of that disk */
+struct SmartCollection
+{
+    std::shared_future<void> ready;
+    std::shared_ptr<const SmartStatus> result;
+    QElapsedTimer age;
+};
+
+static QMutex collectionMutex;
+static QHash<QString, SmartCollection> collections;
+static int collectionTimeToLive = 60000;
+
 SmartStatus::SmartStatus(const QString &device_path) :
     m_DevicePath(device_path),
+    m_Loaded(false),
     m_InitSuccess(false),
     m_Status(false),
     m_ModelName(),
@@ -38,10 +61,118 @@ SmartStatus::SmartStatus(const QString &device_path) :
     m_PowerCycles(0),
     m_PoweredOn(0)
 {
-    update();
 }
 
+/** Collects the SMART data of the disk now, even if a recent result is cached. */
 void SmartStatus::update()
+{
+    std::shared_ptr<SmartStatus> result = std::make_shared<SmartStatus>(devicePath());
+    result->read();
+    result->m_Loaded = true;
+
+    std::promise<void> done;
+    done.set_value();
+
+    SmartCollection collection;
+    collection.ready = done.get_future().share();
+    collection.result = result;
+    collection.age.start();
+
+    {
+        QMutexLocker locker(&collectionMutex);
+        collections.insert(devicePath(), collection);
+    }
+
+    m_Pending = collection.ready;
+    m_Collected = collection.result;
+    m_Loaded = false;
+    load();
+}
+
+/** Starts collecting the SMART data of the disk on the worker pool, unless a result that is
+    younger than timeToLive() is cached or a collection is already running. Call this for all
+    disks before reading any of them to query the disks in parallel.
+
+    @return a future that is ready once the getters no longer have to wait
+*/
+std::shared_future<void> SmartStatus::fetch() const
+{
+    static QThreadPool pool;
+    pool.setMaxThreadCount(maxSmartThreads);
+
+    QMutexLocker locker(&collectionMutex);
+
+    auto it = collections.find(devicePath());
+    const bool running = it != collections.end() && it->ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (it == collections.end() || (!running && it->age.hasExpired(collectionTimeToLive))) {
+        std::shared_ptr<SmartStatus> result = std::make_shared<SmartStatus>(devicePath());
+        auto done = std::make_shared<std::promise<void>>();
+
+        SmartCollection collection;
+        collection.ready = done->get_future().share();
+        collection.result = result;
+        collection.age.start();
+        it = collections.insert(devicePath(), collection);
+
+        pool.start(QRunnable::create([result, done] {
+            result->read();
+            result->m_Loaded = true;
+            done->set_value();
+        }));
+    }
+
+    m_Pending = it->ready;
+    m_Collected = it->result;
+    m_Loaded = false;
+    return m_Pending;
+}
+
+/** @return how long collected SMART data is reused, in milliseconds */
+int SmartStatus::timeToLive()
+{
+    QMutexLocker locker(&collectionMutex);
+    return collectionTimeToLive;
+}
+
+/** @param msecs how long collected SMART data is reused, in milliseconds. 0 collects it again for every fetch(). */
+void SmartStatus::setTimeToLive(int msecs)
+{
+    QMutexLocker locker(&collectionMutex);
+    collectionTimeToLive = msecs;
+}
+
+/** Takes over the collected data, starting and waiting for the collection if necessary. */
+void SmartStatus::load() const
+{
+    if (m_Loaded)
+        return;
+
+    if (!m_Collected)
+        fetch();
+
+    m_Pending.wait();
+
+    const SmartStatus& collected = *m_Collected;
+    m_InitSuccess = collected.m_InitSuccess;
+    m_Status = collected.m_Status;
+    m_ModelName = collected.m_ModelName;
+    m_Serial = collected.m_Serial;
+    m_Firmware = collected.m_Firmware;
+    m_Overall = collected.m_Overall;
+    m_SelfTestStatus = collected.m_SelfTestStatus;
+    m_Temp = collected.m_Temp;
+    m_BadSectors = collected.m_BadSectors;
+    m_PowerCycles = collected.m_PowerCycles;
+    m_PoweredOn = collected.m_PoweredOn;
+    m_Attributes = collected.m_Attributes;
+
+    m_Loaded = true;
+    m_Pending = std::shared_future<void>();
+    m_Collected.reset();
+}
+
+/** Runs smartctl and parses its output, blocks until the disk answered. */
+void SmartStatus::read()
 {
     SmartParser parser(devicePath());
 
@@ -69,6 +200,19 @@ void SmartStatus::update()
     setPowerCycles(disk->powerCycles());
     addAttributes(disk->attributes());
     setInitSuccess(true);
+
+    if (SmartHistory::isRecording() && !m_Serial.isEmpty()) {
+        SmartHistory::Values values;
+        const QList<SmartAttributeParsedData> attributes = disk->attributes();
+        for (const SmartAttributeParsedData& attribute : attributes)
+            values.insert(attribute.id(), static_cast<qint64>(attribute.raw()));
+        values.insert(SmartHistory::Temperature, m_Temp);
+        values.insert(SmartHistory::BadSectors, m_BadSectors);
+        values.insert(SmartHistory::PoweredOn, m_PoweredOn);
+        values.insert(SmartHistory::PowerCycles, m_PowerCycles);
+
+        SmartHistory::append(m_Serial, QDateTime::currentSecsSinceEpoch(), values);
+    }
 }
 
 QString SmartStatus::tempToString(quint64 mkelvin)
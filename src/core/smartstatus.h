@@ -19,9 +19,19 @@
 #include <QString>
 #include <QList>
 
+#include <future>
+#include <memory>
+
 struct SkSmartAttributeParsedData;
 struct SkDisk;
 
+/** SMART health data of a disk.
+
+    Nothing is read when a SmartStatus is constructed. The data is collected with smartctl
+    on a shared worker pool, either when fetch() is called or when one of the getters is
+    used first, which then waits for it. Results are shared by all SmartStatus objects of
+    a disk and reused until they are older than timeToLive().
+*/
 class LIBKPMCORE_EXPORT SmartStatus
 {
 public:
@@ -55,6 +65,10 @@ public:
 
 public:
     void update();
+    std::shared_future<void> fetch() const;
+
+    static int timeToLive();
+    static void setTimeToLive(int msecs);
 
     const QString &devicePath() const
     {
@@ -62,50 +76,62 @@ public:
     }
     bool isValid() const
     {
+        load();
         return m_InitSuccess;
     }
     bool status() const
     {
+        load();
         return m_Status;
     }
     const QString &modelName() const
     {
+        load();
         return m_ModelName;
     }
     const QString &serial() const
     {
+        load();
         return m_Serial;
     }
     const QString &firmware() const
     {
+        load();
         return m_Firmware;
     }
     quint64 temp() const
     {
+        load();
         return m_Temp;
     }
     quint64 badSectors() const
     {
+        load();
         return m_BadSectors;
     }
     quint64 powerCycles() const
     {
+        load();
         return m_PowerCycles;
     }
     quint64 poweredOn() const
     {
+        load();
         return m_PoweredOn;
     }
     const Attributes &attributes() const
     {
+        load();
         return m_Attributes;
     }
     Overall overall() const
     {
+        load();
         return m_Overall;
     }
     SelfTestStatus selfTestStatus() const
     {
+        load();
         return m_SelfTestStatus;
     }
 
@@ -116,6 +142,9 @@ public:
     static QString selfTestStatusToString(SmartStatus::SelfTestStatus s);
 
 private:
+    void read();
+    void load() const;
+
     void setStatus(bool s)
     {
         m_Status = s;
@@ -163,18 +192,24 @@ private:
 
 private:
     const QString m_DevicePath;
-    bool m_InitSuccess;
-    bool m_Status;
-    QString m_ModelName;
-    QString m_Serial;
-    QString m_Firmware;
-    Overall m_Overall;
-    SelfTestStatus m_SelfTestStatus;
-    quint64 m_Temp;
-    quint64 m_BadSectors;
-    quint64 m_PowerCycles;
-    quint64 m_PoweredOn;
-    Attributes m_Attributes;
+
+    // Filled in from the collected data on first use, see load()
+    mutable bool m_Loaded;
+    mutable std::shared_future<void> m_Pending;
+    mutable std::shared_ptr<const SmartStatus> m_Collected;
+
+    mutable bool m_InitSuccess;
+    mutable bool m_Status;
+    mutable QString m_ModelName;
+    mutable QString m_Serial;
+    mutable QString m_Firmware;
+    mutable Overall m_Overall;
+    mutable SelfTestStatus m_SelfTestStatus;
+    mutable quint64 m_Temp;
+    mutable quint64 m_BadSectors;
+    mutable quint64 m_PowerCycles;
+    mutable quint64 m_PoweredOn;
+    mutable Attributes m_Attributes;
 };
 
 #endif
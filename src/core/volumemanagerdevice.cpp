@@ -35,6 +35,32 @@ void VolumeManagerDevice::scanDevices(QList<Device*>& devices)
     LvmDevice::scanSystemLVM(devices); // LVM scanner needs all other devices, so should be last
 }
 
+/** Scans for volume manager devices without looking at the devices they are made of.
+ *
+ *  This only reads the system, so it may run in any thread. Call updateMembers() on
+ *  the thread that owns the devices before the result is used.
+ *
+ *  @return the volume manager devices, owned by the caller
+ */
+QList<Device*> VolumeManagerDevice::scanVolumeManagerDevices()
+{
+    QList<Device*> devices;
+    SoftwareRAID::scanSoftwareRAID(devices);
+    for (const auto &d : LvmDevice::scanVolumeGroups())
+        devices.append(d);
+
+    return devices;
+}
+
+/** Tells the volume manager devices which Partitions of other devices they are made of.
+ *
+ *  @param devices all devices, those with a partition table and the volume manager devices
+ */
+void VolumeManagerDevice::updateMembers(const QList<Device*>& devices)
+{
+    LvmDevice::updatePhysicalVolumes(devices);
+}
+
 QString VolumeManagerDevice::prettyDeviceNodeList() const
 {
     return deviceNodes().join(QStringLiteral(", "));
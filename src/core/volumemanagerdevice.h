@@ -72,6 +72,8 @@ protected:
 public:
 
     static void scanDevices(QList<Device*>& devices);
+    static QList<Device*> scanVolumeManagerDevices();
+    static void updateMembers(const QList<Device*>& devices);
 
     /** join deviceNodes together into comma-separated list
      *
@@ -13,6 +13,7 @@
 #include "util/externalcommand.h"
 #include "util/capacity.h"
 #include "util/report.h"
+#include "util/toolprobecache.h"
 
 #include <QRegularExpression>
 #include <QString>
@@ -59,9 +60,10 @@ void btrfs::init()
     m_GetUUID = cmdSupportCore;
 
     if (m_Create == cmdSupportFileSystem) {
-        ExternalCommand cmd(QStringLiteral("mkfs.btrfs"), QStringList() << QStringLiteral("-O") << QStringLiteral("list-all"));
-        if (cmd.run(-1) && cmd.exitCode() == 0) {
-            QStringList lines = cmd.output().split(QStringLiteral("\n"));
+        int exitCode;
+        QByteArray output;
+        if (ToolProbeCache::self().probe(QStringLiteral("mkfs.btrfs"), { QStringLiteral("-O"), QStringLiteral("list-all") }, exitCode, &output) && exitCode == 0) {
+            QStringList lines = QString::fromLocal8Bit(output).split(QStringLiteral("\n"));
 
             // First line is introductory text, we don't need it
             lines.removeFirst();
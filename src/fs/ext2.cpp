@@ -15,6 +15,33 @@
 #include <QRegularExpression>
 #include <QString>
 
+#include <algorithm>
+
+// Free extents smaller than this are read and copied like used data
+constexpr qint64 minimumUnusedExtent = 1 << 20;
+
+/** Parses the completion lines "pass current max device" that e2fsck -C writes.
+    Passes are weighted like in the progress bar of e2fsck itself.
+    @return the progress in percent or -1
+*/
+static int e2fsckProgress(const QString& line)
+{
+    static const QRegularExpression re(QStringLiteral("^([1-5]) (\\d+) (\\d+) \\S+$"));
+    static const int passPercent[] = { 0, 70, 90, 92, 95, 100 };
+
+    const QRegularExpressionMatch match = re.match(line);
+    if (!match.hasMatch())
+        return -1;
+
+    const int pass = match.captured(1).toInt();
+    const qint64 current = match.captured(2).toLongLong();
+    const qint64 max = match.captured(3).toLongLong();
+    if (max <= 0)
+        return passPercent[pass - 1];
+
+    return passPercent[pass - 1] + static_cast<int>(qMin(current, max) * (passPercent[pass] - passPercent[pass - 1]) / max);
+}
+
 namespace FS
 {
 FileSystem::CommandSupportType ext2::m_GetUsed = FileSystem::cmdSupportNone;
@@ -147,9 +174,63 @@ qint64 ext2::readUsedCapacity(const QString& deviceNode) const
     return -1;
 }
 
+/** Reads the free blocks of all block groups, see FileSystem::readUnusedExtents().
+    @param deviceNode the device node for the Partition the file system is on
+    @return (offset, length) pairs in bytes relative to the start of the file system, sorted by offset
+*/
+QList<QPair<qint64, qint64>> ext2::readFreeExtents(const QString& deviceNode)
+{
+    // Without -h dumpe2fs also lists the free blocks of every block group, e.g.
+    //   Free blocks: 1090-8192, 8200, 9000-32767
+    ExternalCommand cmd(QStringLiteral("dumpe2fs"), { deviceNode });
+
+    QList<QPair<qint64, qint64>> extents;
+    if (!cmd.run() || cmd.exitCode() != 0)
+        return extents;
+
+    QRegularExpression re(QStringLiteral("Block size:\\s+(\\d+)"));
+    QRegularExpressionMatch reBlockSize = re.match(cmd.output());
+    const qint64 blockSize = reBlockSize.hasMatch() ? reBlockSize.captured(1).toLongLong() : -1;
+    if (blockSize <= 0)
+        return extents;
+
+    // Group lines are indented, the unindented header line only has the total count.
+    re.setPattern(QStringLiteral("^\\s+Free blocks: ([\\d, -]*)$"));
+    re.setPatternOptions(QRegularExpression::MultilineOption);
+    QRegularExpressionMatchIterator it = re.globalMatch(cmd.output());
+    while (it.hasNext()) {
+        const QStringList ranges = it.next().captured(1).split(QLatin1Char(','), Qt::SkipEmptyParts);
+        for (const QString& range : ranges) {
+            if (range.trimmed().isEmpty())
+                continue;
+
+            const QStringList bounds = range.trimmed().split(QLatin1Char('-'));
+            const qint64 first = bounds.first().toLongLong();
+            const qint64 last = bounds.last().toLongLong();
+            const qint64 offset = first * blockSize;
+            const qint64 length = (last - first + 1) * blockSize;
+
+            // Free ranges at group boundaries are adjacent, merge them.
+            if (!extents.isEmpty() && extents.last().first + extents.last().second == offset)
+                extents.last().second += length;
+            else
+                extents.append({ offset, length });
+        }
+    }
+
+    // Tiny extents are not worth skipping, they only make the list longer.
+    extents.erase(std::remove_if(extents.begin(), extents.end(), [] (const QPair<qint64, qint64>& extent) {
+        return extent.second < minimumUnusedExtent;
+    }), extents.end());
+
+    return extents;
+}
+
 bool ext2::check(Report& report, const QString& deviceNode) const
 {
-    ExternalCommand cmd(report, QStringLiteral("e2fsck"), { QStringLiteral("-f"), QStringLiteral("-y"), QStringLiteral("-v"), deviceNode });
+    // Completion information goes to standard output, where it is picked up as progress.
+    ExternalCommand cmd(report, QStringLiteral("e2fsck"), { QStringLiteral("-f"), QStringLiteral("-y"), QStringLiteral("-v"), QStringLiteral("-C"), QStringLiteral("1"), deviceNode });
+    cmd.setProgressParser(e2fsckProgress);
     return cmd.run(-1) && (cmd.exitCode() == 0 || cmd.exitCode() == 1 || cmd.exitCode() == 2 || cmd.exitCode() == 256);
 }
 
@@ -43,6 +43,8 @@ public:
     bool writeLabelOnline(Report& report, const QString& deviceNode, const QString& mountPoint, const QString& newLabel) override;
     bool updateUUID(Report& report, const QString& deviceNode) const override;
 
+    static QList<QPair<qint64, qint64>> readFreeExtents(const QString& deviceNode);
+
     CommandSupportType supportGetUsed() const override {
         return m_GetUsed;
     }
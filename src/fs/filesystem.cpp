@@ -15,6 +15,8 @@
 #include "fs/filesystem.h"
 #include "core/fstab.h"
 
+#include "fs/ext2.h"
+
 #include "fs/lvm2_pv.h"
 
 #include "backend/corebackend.h"
@@ -23,14 +25,13 @@
 #include "util/externalcommand.h"
 #include "util/capacity.h"
 #include "util/helpers.h"
+#include "util/mounttable.h"
+#include "util/toolprobecache.h"
 
 #include <KLocalizedString>
 
 #include <QColor>
 #include <QFile>
-#include <QFileInfo>
-#include <QStandardPaths>
-#include <QStorageInfo>
 #include <QTemporaryDir>
 
 const std::vector<QColor> FileSystem::defaultColorCode =
@@ -201,6 +202,29 @@ qint64 FileSystem::readUsedCapacity(const QString& deviceNode) const
     return -1;
 }
 
+/** Reads the extents this FileSystem does not use.
+
+    The contents of these extents do not matter to the FileSystem, so backups can store
+    them as holes instead of reading them. Must only be called if the FileSystem is not mounted.
+
+    This is not virtual to keep the vtable of FileSystem, it dispatches on type() instead.
+
+    @param deviceNode the device node for the Partition the FileSystem is on
+    @return (offset, length) pairs in bytes relative to the start of the FileSystem,
+            sorted by offset, or an empty list if not known
+*/
+QList<QPair<qint64, qint64>> FileSystem::readUnusedExtents(const QString& deviceNode) const
+{
+    switch (type()) {
+    case Type::Ext2:
+    case Type::Ext3:
+    case Type::Ext4:
+        return ext2::readFreeExtents(deviceNode);
+    default:
+        return {};
+    }
+}
+
 FileSystem::Type FileSystem::detectFileSystem(const QString& partitionPath)
 {
     return CoreBackendManager::self()->backend()->detectFileSystem(partitionPath);
@@ -214,16 +238,7 @@ QString FileSystem::detectMountPoint(FileSystem* fs, const QString& partitionPat
     if (partitionPath.isEmpty()) // Happens when during initial scan LUKS is closed
         return QString();
 
-    QStringList mountPoints;
-    QFileInfo partitionPathFileInfo(partitionPath);
-    QString partitionCanonicalPath = partitionPathFileInfo.canonicalFilePath();
-    const QList<QStorageInfo> mountedVolumes = QStorageInfo::mountedVolumes();
-    for (const QStorageInfo &storage : mountedVolumes) {
-        if (partitionCanonicalPath == QFileInfo(QFile::decodeName(storage.device())).canonicalFilePath() ) {
-            mountPoints.append(storage.rootPath());
-        }
-    }
-
+    QStringList mountPoints = MountTable::self().mountPoints(partitionPath);
     mountPoints.append(possibleMountPoints(partitionPath));
 
     return mountPoints.isEmpty() ? QString() : mountPoints.first();
@@ -652,17 +667,11 @@ qint64 FileSystem::lastSector() const
 
 bool FileSystem::findExternal(const QString& cmdName, const QStringList& args, int expectedCode)
 {
-    QString cmdFullPath = QStandardPaths::findExecutable(cmdName);
-    if (cmdFullPath.isEmpty())
-        cmdFullPath = QStandardPaths::findExecutable(cmdName, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
-    if (cmdFullPath.isEmpty())
-        return false;
-
-    ExternalCommand cmd(cmdFullPath, args);
-    if (!cmd.run())
+    int exitCode;
+    if (!ToolProbeCache::self().probe(cmdName, args, exitCode))
         return false;
 
-    return cmd.exitCode() == 0 || cmd.exitCode() == expectedCode;
+    return exitCode == 0 || exitCode == expectedCode;
 }
 
 void FileSystem::addAvailableFeature(const QString& name)
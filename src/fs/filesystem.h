@@ -21,6 +21,7 @@
 
 #include <QVariant>
 #include <QList>
+#include <QPair>
 #include <QStringList>
 #include <QString>
 #include <QtGlobal>
@@ -124,6 +125,7 @@ public:
     virtual void init() {}
     virtual void scan(const QString& deviceNode);
     virtual qint64 readUsedCapacity(const QString& deviceNode) const;
+    QList<QPair<qint64, qint64>> readUnusedExtents(const QString& deviceNode) const;
     virtual QString readLabel(const QString& deviceNode) const;
     virtual bool create(Report& report, const QString& deviceNode);
     virtual bool createWithLabel(Report& report, const QString& deviceNode, const QString& label);
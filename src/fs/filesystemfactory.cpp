@@ -10,7 +10,11 @@
     SPDX-License-Identifier: GPL-3.0-or-later
 */
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "fs/filesystemfactory.h"
 #include "fs/filesystem.h"
@@ -54,11 +58,58 @@
 #include "backend/corebackendmanager.h"
 #include "backend/corebackend.h"
 
+#include "util/toolprobecache.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+
+// Probing the support tools mostly waits for the helper, a few threads are enough to keep it busy
+constexpr int maxProbeThreads = 8;
+
 FileSystemFactory::FileSystems FileSystemFactory::m_FileSystems;
 
-/** Initializes the instance. */
+// Pending support tool probes of the file system prototypes, see FileSystemFactory::init()
+static QMutex probeMutex;
+static QMap<FileSystem::Type, std::shared_future<void>> probes;
+
+/** Waits until the support tools of a file system have been probed.
+    @param t the FileSystem's type
+*/
+static void waitForProbe(FileSystem::Type t)
+{
+    std::shared_future<void> probe;
+    {
+        QMutexLocker locker(&probeMutex);
+        probe = probes.value(t);
+    }
+
+    if (probe.valid())
+        probe.wait();
+}
+
+/** Waits until the support tools of all file systems have been probed. */
+static void waitForProbes()
+{
+    QMutexLocker locker(&probeMutex);
+    const auto pending = probes;
+    locker.unlock();
+
+    for (const auto& probe : pending)
+        probe.wait();
+}
+
+/** Initializes the instance.
+
+    Which support tools are available is probed in the background, every file system in
+    its own task, except for those that share the support flags of a base class. Creating a
+    FileSystem only waits for the probes of its own type, map() waits for all of them. Probe results are cached across runs, see ToolProbeCache.
+*/
 void FileSystemFactory::init()
 {
+    waitForProbes();
+
     FileSystems fileSystems;
     fileSystems.insert(FileSystem::Type::Apfs, new FS::apfs(-1, -1, -1, QString()));
     fileSystems.insert(FileSystem::Type::BitLocker, new FS::bitlocker(-1, -1, -1, QString()));
@@ -96,8 +147,68 @@ void FileSystemFactory::init()
     fileSystems.insert(FileSystem::Type::Xfs, new FS::xfs(-1, -1, -1, QString()));
     fileSystems.insert(FileSystem::Type::Zfs, new FS::zfs(-1, -1, -1, QString()));
 
-    for (const auto &fs : std::as_const(fileSystems))
-        fs->init();
+    static QThreadPool pool;
+    pool.setMaxThreadCount(maxProbeThreads);
+
+    // Derived file systems that do not override init() write the static support flags of their
+    // base class, so these run in one task and wait for each other. Within the task they keep
+    // the order of the map, so the same init() has the last word as when they ran one by one.
+    static const QList<QList<FileSystem::Type>> sharedFlags = {
+        { FileSystem::Type::Ext2, FileSystem::Type::Ext3, FileSystem::Type::Ext4 },
+        { FileSystem::Type::Fat12, FileSystem::Type::Fat16, FileSystem::Type::Fat32 },
+        { FileSystem::Type::Luks, FileSystem::Type::Luks2 },
+    };
+
+    QList<QList<FileSystem::Type>> groups;
+    QHash<int, int> sharedGroups; // index in sharedFlags, index in groups
+    for (auto it = fileSystems.cbegin(); it != fileSystems.cend(); ++it) {
+        int shared = -1;
+        for (int i = 0; i < sharedFlags.size(); ++i)
+            if (sharedFlags[i].contains(it.key()))
+                shared = i;
+
+        if (shared < 0) {
+            groups.append({ it.key() });
+        } else {
+            if (!sharedGroups.contains(shared)) {
+                sharedGroups.insert(shared, groups.size());
+                groups.append({});
+            }
+            groups[sharedGroups.value(shared)].append(it.key());
+        }
+    }
+
+    QMap<FileSystem::Type, std::shared_future<void>> pending;
+    std::vector<std::pair<std::vector<FileSystem*>, std::shared_ptr<std::promise<void>>>> tasks;
+    for (const auto& group : std::as_const(groups)) {
+        auto done = std::make_shared<std::promise<void>>();
+        const std::shared_future<void> future = done->get_future().share();
+
+        std::vector<FileSystem*> members;
+        for (const auto type : group) {
+            members.push_back(fileSystems.value(type));
+            pending.insert(type, future);
+        }
+        tasks.emplace_back(members, done);
+    }
+
+    {
+        QMutexLocker locker(&probeMutex);
+        probes = pending;
+    }
+
+    auto remaining = std::make_shared<std::atomic<int>>(static_cast<int>(tasks.size()));
+    for (const auto& task : tasks) {
+        const std::vector<FileSystem*> members = task.first;
+        auto done = task.second;
+        pool.start(QRunnable::create([members, done, remaining] {
+            for (FileSystem* fs : members)
+                fs->init();
+            done->set_value();
+            if (--*remaining == 0)
+                ToolProbeCache::self().save();
+        }));
+    }
 
     qDeleteAll(m_FileSystems);
     m_FileSystems.clear();
@@ -116,6 +227,8 @@ void FileSystemFactory::init()
 */
 FileSystem* FileSystemFactory::create(FileSystem::Type t, qint64 firstsector, qint64 lastsector, qint64 sectorSize, qint64 sectorsused, const QString& label, const QVariantMap& features, const QString& uuid)
 {
+    waitForProbe(t);
+
     FileSystem* fs = nullptr;
 
     switch (t) {
@@ -176,6 +289,7 @@ FileSystem* FileSystemFactory::create(const FileSystem& other)
 /** @return the map of FileSystems */
 const FileSystemFactory::FileSystems& FileSystemFactory::map()
 {
+    waitForProbes();
     return m_FileSystems;
 }
 
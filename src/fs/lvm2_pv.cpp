@@ -12,10 +12,12 @@
 
 #include "fs/lvm2_pv.h"
 #include "core/device.h"
+#include "core/lvmreport.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
 
+#include <QRegularExpression>
 #include <QString>
 
 #include <KLocalizedString>
@@ -98,6 +100,10 @@ qint64 lvm2_pv::maxCapacity() const
 
 qint64 lvm2_pv::readUsedCapacity(const QString& deviceNode) const
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv))
+        return pv.used < 0 ? -1 : pv.used + pv.peStart;
+
     QString pvUsed = getpvField(QStringLiteral("pv_used"), deviceNode);
     QString metadataOffset = getpvField(QStringLiteral("pe_start"), deviceNode);
     return pvUsed.isEmpty() ? -1 : pvUsed.toLongLong() + metadataOffset.toLongLong();
@@ -112,20 +118,21 @@ bool lvm2_pv::check(Report& report, const QString& deviceNode) const
 bool lvm2_pv::create(Report& report, const QString& deviceNode)
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvcreate"), QStringLiteral("--force"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    return LvmReport::runChange(cmd);
 }
 
 bool lvm2_pv::remove(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvremove"), QStringLiteral("--force"), QStringLiteral("--force"), QStringLiteral("--yes"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    return LvmReport::runChange(cmd);
 }
 
 bool lvm2_pv::resize(Report& report, const QString& deviceNode, qint64 length) const
 {
     bool rval = true;
 
-    qint64 metadataOffset = getpvField(QStringLiteral("pe_start"), deviceNode).toLongLong();
+    LvmReport::PhysicalVolume pv;
+    qint64 metadataOffset = LvmReport::self().physicalVolume(deviceNode, pv) ? pv.peStart : getpvField(QStringLiteral("pe_start"), deviceNode).toLongLong();
 
     qint64 lastPE = getTotalPE(deviceNode) - 1; // starts from 0
     if (lastPE > 0) { // make sure that the PV is already in a VG
@@ -135,12 +142,16 @@ bool lvm2_pv::resize(Report& report, const QString& deviceNode, qint64 length) c
             ExternalCommand moveCmd(report,
                                     QStringLiteral("lvm"), {
                                     QStringLiteral("pvmove"),
+                                    QStringLiteral("--interval"),
+                                    QStringLiteral("1"),
                                     QStringLiteral("--alloc"),
                                     QStringLiteral("anywhere"),
                                     deviceNode + QStringLiteral(":") + QString::number(firstMovedPE) + QStringLiteral("-") + QString::number(lastPE),
                                     deviceNode + QStringLiteral(":") + QStringLiteral("0-") + QString::number(firstMovedPE - 1)
                                     });
+            moveCmd.setProgressParser(pvmoveProgress);
             rval = moveCmd.run(-1) && (moveCmd.exitCode() == 0 || moveCmd.exitCode() == 5); // FIXME: exit code 5: NO data to move
+            LvmReport::self().invalidate();
         }
     }
 
@@ -150,7 +161,18 @@ bool lvm2_pv::resize(Report& report, const QString& deviceNode, qint64 length) c
                                 QStringLiteral("--setphysicalvolumesize"),
                                 QString::number(length) + QStringLiteral("B"),
                                 deviceNode });
-    return rval && cmd.run(-1) && cmd.exitCode() == 0;
+    return rval && LvmReport::runChange(cmd);
+}
+
+/** Parses the lines "/dev/sdb1: Moved: 12.50%" that pvmove --interval writes.
+    @return the progress in percent or -1
+*/
+int lvm2_pv::pvmoveProgress(const QString& line)
+{
+    static const QRegularExpression re(QStringLiteral("Moved:\\s*([\\d.]+)%"));
+
+    const QRegularExpressionMatch match = re.match(line);
+    return match.hasMatch() ? static_cast<int>(match.captured(1).toDouble()) : -1;
 }
 
 bool lvm2_pv::resizeOnline(Report& report, const QString& deviceNode, const QString& mountPoint, qint64 length) const
@@ -162,11 +184,15 @@ bool lvm2_pv::resizeOnline(Report& report, const QString& deviceNode, const QStr
 bool lvm2_pv::updateUUID(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvchange"), QStringLiteral("--uuid"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    return LvmReport::runChange(cmd);
 }
 
 QString lvm2_pv::readUUID(const QString& deviceNode) const
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv))
+        return pv.uuid;
+
     return getpvField(QStringLiteral("pv_uuid"), deviceNode);
 }
 
@@ -200,18 +226,32 @@ bool lvm2_pv::canUnmount(const QString& deviceNode) const
 
 qint64 lvm2_pv::getTotalPE(const QString& deviceNode)
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv))
+        return pv.peCount;
+
     QString pvPeCount = getpvField(QStringLiteral("pv_pe_count"), deviceNode);
     return pvPeCount.isEmpty() ? -1 : pvPeCount.toLongLong();
 }
 
 qint64 lvm2_pv::getAllocatedPE(const QString& deviceNode)
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv))
+        return pv.peAllocCount;
+
     QString pvPeAllocCount = getpvField(QStringLiteral("pv_pe_alloc_count"), deviceNode);
     return pvPeAllocCount.isEmpty() ? -1 : pvPeAllocCount.toLongLong();
 }
 
 void lvm2_pv::getPESize(const QString& deviceNode)
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv)) {
+        m_PESize = pv.extentSize;
+        return;
+    }
+
     QString vgExtentSize = getpvField(QStringLiteral("vg_extent_size"), deviceNode);
     m_PESize = vgExtentSize.isEmpty() ? -1 : vgExtentSize.toLongLong();
 }
@@ -245,6 +285,10 @@ QString  lvm2_pv::getpvField(const QString& fieldName, const QString& deviceNode
 
 QString lvm2_pv::getVGName(const QString& deviceNode)
 {
+    LvmReport::PhysicalVolume pv;
+    if (LvmReport::self().physicalVolume(deviceNode, pv))
+        return pv.vgName;
+
     return getpvField(QStringLiteral("vg_name"), deviceNode);
 }
 
@@ -260,6 +304,10 @@ QList<LvmPV> lvm2_pv::getPVinNode(const PartitionNode* parent)
         if (p == nullptr)
             continue;
 
+        // An LV that was never activated holds no PV that LVM can see
+        if (!p->isProbed())
+            continue;
+
         if (node->children().size() > 0)
             partitions.append(getPVinNode(node));
 
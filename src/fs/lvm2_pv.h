@@ -161,6 +161,7 @@ public:
     static QString getVGName(const QString& deviceNode);
     static QList<LvmPV> getPVinNode(const PartitionNode* parent);
     static QList<LvmPV> getPVs(const QList<Device*>& devices);
+    static int pvmoveProgress(const QString& line);
 
     qint64 allocatedPE() const { return m_AllocatedPE; }
     qint64 freePE() const { return m_TotalPE - m_AllocatedPE; }
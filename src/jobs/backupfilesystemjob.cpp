@@ -54,8 +54,14 @@ bool BackupFileSystemJob::run(Report& parent)
             report->line() << xi18nc("@info:progress", "Could not open file system on source partition <filename>%1</filename> for backup.", sourcePartition().deviceNode());
         else if (!copyTarget.open())
             report->line() << xi18nc("@info:progress", "Could not create backup file <filename>%1</filename>.", fileName());
-        else
+        else {
+            // Free space of the file system is not read at all, it ends up as holes in the image.
+            copySource.setUnusedExtents(sourcePartition().fileSystem().readUnusedExtents(sourcePartition().deviceNode()));
+            // Image files named *.zst are written as compressed backups.
+            if (fileName().endsWith(QStringLiteral(".zst"), Qt::CaseInsensitive))
+                copyTarget.setCompressed(static_cast<qint32>(sourcePartition().fileSystem().type()));
             rval = copyBlocks(*report, copyTarget, copySource);
+        }
     }
 
     jobFinished(*report, rval);
@@ -38,6 +38,11 @@ bool CheckFileSystemJob::run(Report& parent)
     return rval;
 }
 
+qint32 CheckFileSystemJob::numSteps() const
+{
+    return 100;
+}
+
 QString CheckFileSystemJob::description() const
 {
     return xi18nc("@info:progress", "Check file system on partition <filename>%1</filename>", partition().deviceNode());
@@ -39,6 +39,15 @@ bool Job::copyBlocks(Report& report, CopyTarget& target, CopySource& source)
     return copyCmd.copyBlocks(source, target);
 }
 
+bool Job::eraseBlocks(Report& report, CopyTargetDevice& target)
+{
+    m_Report = &report;
+    ExternalCommand eraseCmd;
+    connect(&eraseCmd, &ExternalCommand::progress, this, &Job::progress, Qt::QueuedConnection);
+    connect(&eraseCmd, &ExternalCommand::reportSignal, this, &Job::updateReport, Qt::QueuedConnection);
+    return eraseCmd.eraseBlocks(target);
+}
+
 bool Job::rollbackCopyBlocks(Report& report, CopyTarget& origTarget, CopySource& origSource)
 {
     if (!origSource.overlaps(origTarget)) {
@@ -103,12 +112,20 @@ Report* Job::jobStarted(Report& parent)
 {
     Q_EMIT started();
 
-    return parent.newChild(xi18nc("@info:progress", "Job: %1", description()));
+    Report* report = parent.newChild(xi18nc("@info:progress", "Job: %1", description()));
+
+    // Commands that report their progress move the job along within its steps.
+    connect(report, &Report::progressChanged, this, [this] (int percent) {
+        Q_EMIT progress(qBound(0, percent, 100) * numSteps() / 100);
+    });
+
+    return report;
 }
 
 void Job::jobFinished(Report& report, bool b)
 {
     setStatus(b ? Status::Success : Status::Error);
+
     Q_EMIT progress(numSteps());
     Q_EMIT finished();
 
@@ -21,6 +21,7 @@ class QIcon;
 
 class CopySource;
 class CopyTarget;
+class CopyTargetDevice;
 class Report;
 
 /** Base class for all Jobs.
@@ -76,6 +77,7 @@ public:
 protected:
     bool copyBlocks(Report& report, CopyTarget& target, CopySource& source);
     bool rollbackCopyBlocks(Report& report, CopyTarget& origTarget, CopySource& origSource);
+    bool eraseBlocks(Report& report, CopyTargetDevice& target);
 
     Report* jobStarted(Report& parent);
     void jobFinished(Report& report, bool b);
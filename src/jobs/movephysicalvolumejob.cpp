@@ -48,6 +48,11 @@ bool MovePhysicalVolumeJob::run(Report& parent)
     return rval;
 }
 
+qint32 MovePhysicalVolumeJob::numSteps() const
+{
+    return 100;
+}
+
 QString MovePhysicalVolumeJob::description() const
 {
     QString movedPartitions = QString();
@@ -80,6 +80,11 @@ bool RestoreFileSystemJob::run(Report& parent)
                         t = backendPartitionTable->detectFileSystemBySector(*report, targetDevice(), targetPartition().firstSector());
                 }
 
+                // Compressed backups know what file system they contain.
+                if (t == FileSystem::Type::Unknown && copySource.isCompressed() && copySource.fileSystemType() > 0
+                        && copySource.fileSystemType() < static_cast<qint32>(FileSystem::Type::__lastType))
+                    t = static_cast<FileSystem::Type>(copySource.fileSystemType());
+
                 FileSystem* fs = FileSystemFactory::create(t, targetPartition().firstSector(), newLastSector, targetPartition().sectorSize());
 
                 targetPartition().deleteFileSystem();
@@ -62,7 +62,17 @@ bool ShredFileSystemJob::run(Report& parent)
         else if (!copyTarget.open())
             report->line() << xi18nc("@info:progress", "Could not open target partition <filename>%1</filename> to restore to.", partition().deviceNode());
         else {
-            rval = copyBlocks(*report, copyTarget, copySource);
+            // Overwriting with zeros can be left to the device if it supports WRITE ZEROES,
+            // unless KPMCORE_SHRED_FAST is set to 0. Otherwise, or if that fails, zeros are copied.
+            const bool fastErase = !m_RandomShred && (!qEnvironmentVariableIsSet("KPMCORE_SHRED_FAST") || qEnvironmentVariableIntValue("KPMCORE_SHRED_FAST") != 0);
+            if (fastErase)
+                rval = eraseBlocks(*report, copyTarget);
+
+            if (!rval) {
+                if (fastErase)
+                    report->line() << xi18nc("@info:progress", "The device cannot erase <filename>%1</filename> by itself, overwriting it with zeros.", partition().deviceNode());
+                rval = copyBlocks(*report, copyTarget, copySource);
+            }
             report->line() << i18nc("@info:progress", "Closing device. This may take a few seconds.");
         }
     }
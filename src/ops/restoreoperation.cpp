@@ -25,6 +25,7 @@
 #include "fs/luks.h"
 
 #include "util/capacity.h"
+#include "util/compressedbackup.h"
 #include "util/report.h"
 
 #include <QDebug>
@@ -33,6 +34,16 @@
 
 #include <KLocalizedString>
 
+/** @return the number of bytes an image file restores, for compressed backups the length recorded in the header */
+static qint64 imageFileLength(const QString& filename)
+{
+    CompressedBackup::Header header;
+    if (CompressedBackup::readHeader(filename, header))
+        return header.sourceLength;
+
+    return QFileInfo(filename).size();
+}
+
 /** Creates a new RestoreOperation.
     @param d the Device to restore the Partition to
     @param p pointer to the Partition that will be restored. May not be nullptr.
@@ -45,7 +56,7 @@ RestoreOperation::RestoreOperation(Device& d, Partition* p, const QString& filen
     m_FileName(filename),
     m_OverwrittenPartition(nullptr),
     m_MustDeleteOverwritten(false),
-    m_ImageLength(QFileInfo(filename).size() / 512), // 512 being the "sector size" of an image file.
+    m_ImageLength(imageFileLength(filename) / 512), // 512 being the "sector size" of an image file.
     m_CreatePartitionJob(nullptr),
     m_RestoreJob(nullptr),
     m_CheckTargetJob(nullptr),
@@ -215,7 +226,7 @@ Partition* RestoreOperation::createRestorePartition(const Device& device, Partit
     if (!fileInfo.exists())
         return nullptr;
 
-    const qint64 end = start + fileInfo.size() / device.logicalSize() - 1;
+    const qint64 end = start + imageFileLength(filename) / device.logicalSize() - 1;
     Partition* p = new Partition(&parent, device, PartitionRole(r), FileSystemFactory::create(FileSystem::Type::Unknown, start, end, device.logicalSize()), start, end, QString());
 
     p->setState(Partition::State::Restore);
@@ -22,6 +22,7 @@
 #include "core/partitiontable.h"
 #include "core/partitionalignment.h"
 #include "core/raid/softwareraid.h"
+#include "core/smartstatus.h"
 
 #include "fs/filesystemfactory.h"
 #include "fs/luks.h"
@@ -31,11 +32,15 @@
 #include "util/externalcommand.h"
 #include "util/helpers.h"
 
+#include <atomic>
+#include <functional>
 #include <utility>
+#include <vector>
 
 #include <QDataStream>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -43,12 +48,17 @@
 #include <QStorageInfo>
 #include <QString>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
 
 #include <KLocalizedString>
 #include <KPluginFactory>
 
 K_PLUGIN_CLASS_WITH_JSON(SfdiskBackend, "pmsfdiskbackendplugin.json")
 
+// Scanning a disk mostly waits for external tools, so more disks than CPUs are scanned at once.
+constexpr int maxScanThreads = 16;
+
 SfdiskBackend::SfdiskBackend(QObject*, const QList<QVariant>&) :
     CoreBackend()
 {
@@ -63,6 +73,22 @@ QList<Device*> SfdiskBackend::scanDevices(bool excludeReadOnly)
     return scanDevices(excludeReadOnly ? ScanFlags() : ScanFlag::includeReadOnly);
 }
 
+/** Hands a Device scanned in a worker thread with its partition table and partitions over to another thread.
+    Must be called from the thread the objects were created in.
+*/
+static void moveDeviceToThread(Device& d, QThread* thread)
+{
+    std::function<void(PartitionNode&)> moveNode = [&] (PartitionNode& node) {
+        node.moveToThread(thread);
+        for (Partition* p : node.children())
+            moveNode(*p);
+    };
+
+    d.moveToThread(thread);
+    if (d.partitionTable())
+        moveNode(*d.partitionTable());
+}
+
 QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
 {
     const bool includeReadOnly = scanFlags.testFlag(ScanFlag::includeReadOnly);
@@ -71,53 +97,61 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
     QList<Device*> result;
     QStringList deviceNodes;
 
-    ExternalCommand cmd(QStringLiteral("lsblk"),
-                        { QStringLiteral("--nodeps"),
-                          QStringLiteral("--paths"),
-                          QStringLiteral("--sort"), QStringLiteral("name"),
-                          QStringLiteral("--json"),
-                          QStringLiteral("--output"),
-                          QStringLiteral("type,name") });
-
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        const QJsonDocument jsonDocument = QJsonDocument::fromJson(cmd.rawOutput());
-        const QJsonObject jsonObject = jsonDocument.object();
-        const QJsonArray jsonArray = jsonObject[QLatin1String("blockdevices")].toArray();
-        for (const auto &deviceLine : jsonArray) {
-            QJsonObject deviceObject = deviceLine.toObject();
-            if (! (deviceObject[QLatin1String("type")].toString() == QLatin1String("disk")
-                || (includeLoopback && deviceObject[QLatin1String("type")].toString() == QLatin1String("loop")) ))
-            {
-                continue;
-            }
-
-            const QString deviceNode = deviceObject[QLatin1String("name")].toString();
-            if (!includeReadOnly) {
-                QString deviceName = deviceNode;
-                deviceName.remove(QStringLiteral("/dev/"));
-                QFile f(QStringLiteral("/sys/block/%1/ro").arg(deviceName));
-                if (f.open(QIODevice::ReadOnly))
-                    if (f.readLine().trimmed().toInt() == 1)
-                        continue;
-            }
-            deviceNodes << deviceNode;
+    // One lsblk call describes all block devices, scanDevice() looks up everything it can there.
+    const QHash<QString, QJsonObject> blockDevices = readBlockDevices();
+    beginProbeCache(blockDevices);
+    for (const auto& deviceObject : blockDevices) {
+        if (! (deviceObject[QLatin1String("type")].toString() == QLatin1String("disk")
+            || (includeLoopback && deviceObject[QLatin1String("type")].toString() == QLatin1String("loop")) ))
+        {
+            continue;
         }
 
-        int totalDevices = deviceNodes.length();
-        for (int i = 0; i < totalDevices; ++i) {
-            const QString deviceNode = deviceNodes[i];
+        // Older lsblk versions print all values as strings
+        const QJsonValue readOnly = deviceObject[QLatin1String("ro")];
+        if (!includeReadOnly && (readOnly.toBool() || readOnly.toString() == QLatin1String("1")))
+            continue;
 
-            emitScanProgress(deviceNode, i * 100 / totalDevices);
-            Device* device = scanDevice(deviceNode);
-            if (device != nullptr) {
-                result.append(device);
-            }
+        deviceNodes << deviceObject[QLatin1String("name")].toString();
+    }
+    deviceNodes.sort();
+
+    // Disks are scanned concurrently, but the result keeps the order of deviceNodes.
+    // Progress counts the disks that are done, in whatever order they finish.
+    const int totalDevices = deviceNodes.length();
+    std::vector<Device*> devices(totalDevices, nullptr);
+    std::atomic<int> devicesScanned{0};
+
+    QThread* scanThread = QThread::currentThread();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qBound(1, totalDevices, maxScanThreads));
+    for (int i = 0; i < totalDevices; ++i) {
+        pool.start(QRunnable::create([&, i] {
+            const QString& deviceNode = deviceNodes[i];
+            devices[i] = scanDevice(deviceNode, blockDevices.value(deviceNode));
+            if (devices[i])
+                moveDeviceToThread(*devices[i], scanThread);
+            emitScanProgress(deviceNode, ++devicesScanned * 100 / totalDevices);
+        }));
+    }
+    pool.waitForDone();
+
+    for (Device* device : devices) {
+        if (device != nullptr) {
+            result.append(device);
+
+            // Collect the SMART data of all disks at once in the background, the getters
+            // then rarely have to wait for smartctl.
+            if (device->type() == Device::Type::Disk_Device)
+                device->smartStatus().fetch();
         }
-        
     }
 
     VolumeManagerDevice::scanDevices(result); // scan all types of VolumeManagerDevices
 
+    endProbeCache();
+
     return result;
 }
 
@@ -205,28 +239,77 @@ fixInvalidJsonFromSFDisk( QByteArray& s )
     }
 }
 
+/** Runs lsblk once and collects all columns of the given block devices and their children.
+    @param deviceNodes the device nodes to describe, all block devices if empty
+    @return lsblk's JSON objects keyed by device node, without their "children" arrays
+*/
+QHash<QString, QJsonObject> SfdiskBackend::readBlockDevices(const QStringList& deviceNodes)
+{
+    QHash<QString, QJsonObject> blockDevices;
+
+    ExternalCommand cmd(QStringLiteral("lsblk"),
+                        QStringList({ QStringLiteral("--json"),
+                                      QStringLiteral("--bytes"),
+                                      QStringLiteral("--paths"),
+                                      QStringLiteral("--output-all") }) + deviceNodes,
+                        QProcess::ProcessChannelMode::SeparateChannels);
+
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return blockDevices;
+
+    std::function<void(const QJsonArray&)> collect = [&] (const QJsonArray& devices) {
+        for (const auto& device : devices) {
+            QJsonObject deviceObject = device.toObject();
+            const QJsonArray children = deviceObject.take(QLatin1String("children")).toArray();
+            blockDevices.insert(deviceObject[QLatin1String("name")].toString(), deviceObject);
+            collect(children);
+        }
+    };
+    collect(QJsonDocument::fromJson(cmd.rawOutput()).object()[QLatin1String("blockdevices")].toArray());
+
+    return blockDevices;
+}
+
 /** Create a Device for the given device_node and scan it for partitions.
     @param deviceNode the device node (e.g. "/dev/sda")
     @return the created Device object. callers need to free this.
 */
 Device* SfdiskBackend::scanDevice(const QString& deviceNode)
 {
-    ExternalCommand modelCommand(QStringLiteral("lsblk"),
-                        { QStringLiteral("--nodeps"),
-                          QStringLiteral("--noheadings"),
-                          QStringLiteral("--output"), QStringLiteral("model"),
-                          deviceNode });
-    ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
-    ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
+    const QHash<QString, QJsonObject> blockDevices = readBlockDevices({ deviceNode });
+    beginProbeCache(blockDevices);
+    Device* d = scanDevice(deviceNode, blockDevices.value(deviceNode));
+    endProbeCache();
+
+    return d;
+}
+
+/** Create a Device for the given device_node and scan it for partitions.
+    @param deviceNode the device node (e.g. "/dev/sda")
+    @param blockDevice what lsblk knows about the device, see readBlockDevices()
+    @return the created Device object. callers need to free this.
+*/
+Device* SfdiskBackend::scanDevice(const QString& deviceNode, const QJsonObject& blockDevice)
+{
+    // lsblk does not know about everything that can be scanned, e.g. LVM volume groups.
+    // blockdev answers for those devices it does not describe.
+    qint64 deviceSize = blockDevice[QLatin1String("size")].toVariant().toLongLong();
+    int logicalSectorSize = blockDevice[QLatin1String("log-sec")].toVariant().toInt();
+    bool haveSize = deviceSize > 0 && logicalSectorSize > 0;
+
+    if (!haveSize) {
+        ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
+        ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
+        haveSize = sizeCommand.run(-1) && sizeCommand.exitCode() == 0 && sizeCommand2.run(-1) && sizeCommand2.exitCode() == 0;
+        deviceSize = sizeCommand.output().trimmed().toLongLong();
+        logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
+    }
+
     ExternalCommand sfdiskJsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), deviceNode }, QProcess::ProcessChannelMode::SeparateChannels );
 
-    if ( sizeCommand.run(-1) && sizeCommand.exitCode() == 0
-         && sizeCommand2.run(-1) && sizeCommand2.exitCode() == 0
-         && sfdiskJsonCommand.run(-1) )
+    if ( haveSize && sfdiskJsonCommand.run(-1) )
     {
         Device* d = nullptr;
-        qint64 deviceSize = sizeCommand.output().trimmed().toLongLong();
-        int logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
 
         QFile mdstat(QStringLiteral("/proc/mdstat"));
 
@@ -252,28 +335,17 @@ Device* SfdiskBackend::scanDevice(const QString& deviceNode)
             }
         }
 
-        if ( d == nullptr && modelCommand.run(-1) && modelCommand.exitCode() == 0 )
+        if ( d == nullptr && !blockDevice.isEmpty() )
         {
-            QString name = modelCommand.output();
-            name = name.left(name.length() - 1).replace(QLatin1Char('_'), QLatin1Char(' '));
-
-            if (name.trimmed().isEmpty()) {
-                // Get 'lsblk --output kname' in the cases where the model name is not available.
-                // As lsblk doesn't have an option to include a separator in its output, it is
-                // necessary to run it again getting only the kname as output.
-                ExternalCommand kname(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("kname"),
-                                                                deviceNode});
-
-                if (kname.run(-1) && kname.exitCode() == 0)
-                    name = kname.output().trimmed();
-            }
+            QString name = blockDevice[QLatin1String("model")].toString().trimmed().replace(QLatin1Char('_'), QLatin1Char(' '));
+
+            // Use the kernel name in the cases where the model name is not available.
+            if (name.isEmpty())
+                name = QFileInfo(blockDevice[QLatin1String("kname")].toString()).fileName();
 
-            ExternalCommand transport(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("tran"),
-                                                                deviceNode});
             QString icon;
-            if (transport.run(-1) && transport.exitCode() == 0)
-                if (transport.output().trimmed() == QStringLiteral("usb"))
-                    icon = QStringLiteral("drive-removable-media-usb");
+            if (blockDevice[QLatin1String("tran")].toString() == QLatin1String("usb"))
+                icon = QStringLiteral("drive-removable-media-usb");
 
             Log(Log::Level::information) << xi18nc("@info:status", "Device found: %1", name);
 
@@ -526,25 +598,16 @@ void SfdiskBackend::readSectorsUsed(const Device& d, Partition& p, const QString
 
 FileSystem::Type SfdiskBackend::detectFileSystem(const QString& partitionPath)
 {
-    FileSystem::Type rval = FileSystem::Type::Unknown;
-
-    ExternalCommand udevCommand(QStringLiteral("udevadm"), {
-                                 QStringLiteral("info"),
-                                 QStringLiteral("--query=property"),
-                                 partitionPath });
-
-    QString typeRegExp = QStringLiteral("ID_FS_TYPE=(\\w+)");
-    QString versionRegExp = QStringLiteral("ID_FS_VERSION=(\\w+)");
-
-    QString name = {};
+    const ProbeRecord record = probe(partitionPath);
+    QString name = record.type;
 
-    rval = runDetectFileSystemCommand(udevCommand, typeRegExp, versionRegExp, name);
+    FileSystem::Type rval = fileSystemNameToType(record.type, record.version);
 
     // Fallback to blkid which has slightly worse detection but it works on whole block device filesystems.
     if (rval == FileSystem::Type::Unknown) {
         ExternalCommand blkidCommand(QStringLiteral("blkid"), { partitionPath });
-        typeRegExp = QStringLiteral("TYPE=\"(\\w+)\"");
-        versionRegExp = QStringLiteral("SEC_TYPE=\"(\\w+)\"");
+        QString typeRegExp = QStringLiteral("TYPE=\"(\\w+)\"");
+        QString versionRegExp = QStringLiteral("SEC_TYPE=\"(\\w+)\"");
         rval = runDetectFileSystemCommand(blkidCommand, typeRegExp, versionRegExp, name);
     }
 
@@ -654,36 +717,94 @@ static QString decodeFsEncString(const QString &str)
     return decoded;
 }
 
-QString SfdiskBackend::readLabel(const QString& deviceNode) const
+/** Starts keeping probe results for the duration of a scan. Scans may nest.
+    @param blockDevices lsblk's view of the devices to be scanned, see readBlockDevices().
+           Its file system columns are used instead of asking udev again.
+*/
+void SfdiskBackend::beginProbeCache(const QHash<QString, QJsonObject>& blockDevices)
 {
-    ExternalCommand udevCommand(QStringLiteral("udevadm"), {
-                                 QStringLiteral("info"),
-                                 QStringLiteral("--query=property"),
-                                 deviceNode });
-    udevCommand.run();
-    QRegularExpression re(QStringLiteral("ID_FS_LABEL_ENC=(.*)"));
-    QRegularExpressionMatch reFileSystemLabel = re.match(udevCommand.output());
-    if (reFileSystemLabel.hasMatch()) {
-        QString escapedLabel = reFileSystemLabel.captured(1);
-        return decodeFsEncString(escapedLabel);
+    QMutexLocker locker(&m_ProbeMutex);
+    ++m_ProbeScans;
+
+    for (auto it = blockDevices.cbegin(); it != blockDevices.cend(); ++it) {
+        // lsblk reads these from the udev database as well. Devices without a known
+        // file system are left to probe(), which also tries blkid. So are all devices
+        // if lsblk is too old to print the file system version.
+        const QJsonObject& device = it.value();
+        if (!device.contains(QLatin1String("fsver")) || device[QLatin1String("fstype")].toString().isEmpty())
+            continue;
+
+        m_Probes.insert(it.key(), { device[QLatin1String("fstype")].toString(),
+                                    device[QLatin1String("fsver")].toString(),
+                                    device[QLatin1String("label")].toString(),
+                                    device[QLatin1String("uuid")].toString() });
     }
+}
 
-    return QString();
+/** Ends a scan started with beginProbeCache(), the results are dropped when the outermost scan ends. */
+void SfdiskBackend::endProbeCache()
+{
+    QMutexLocker locker(&m_ProbeMutex);
+    if (--m_ProbeScans == 0)
+        m_Probes.clear();
 }
 
-QString SfdiskBackend::readUUID(const QString& deviceNode) const
+/** Reads the file system signature of a device node from udev.
+    While a scan is running every node is queried at most once, and the same record
+    answers detectFileSystem(), readLabel() and readUUID().
+    @param deviceNode the device node to probe
+    @return what udev knows about the file system on the device node
+*/
+SfdiskBackend::ProbeRecord SfdiskBackend::probe(const QString& deviceNode) const
 {
+    {
+        QMutexLocker locker(&m_ProbeMutex);
+        auto it = m_Probes.constFind(deviceNode);
+        if (it != m_Probes.cend())
+            return it.value();
+    }
+
     ExternalCommand udevCommand(QStringLiteral("udevadm"), {
                                  QStringLiteral("info"),
                                  QStringLiteral("--query=property"),
                                  deviceNode });
-    udevCommand.run();
-    QRegularExpression re(QStringLiteral("ID_FS_UUID=(.*)"));
-    QRegularExpressionMatch reFileSystemUUID = re.match(udevCommand.output());
-    if (reFileSystemUUID.hasMatch())
-        return reFileSystemUUID.captured(1);
 
-    return QString();
+    ProbeRecord record;
+    if (udevCommand.run(-1) && udevCommand.exitCode() == 0) {
+        const QStringList lines = udevCommand.output().split(QLatin1Char('\n'));
+        for (const QString& line : lines) {
+            const int separator = line.indexOf(QLatin1Char('='));
+            if (separator < 0)
+                continue;
+
+            const QString key = line.left(separator);
+            const QString value = line.mid(separator + 1);
+            if (key == QLatin1String("ID_FS_TYPE"))
+                record.type = value;
+            else if (key == QLatin1String("ID_FS_VERSION"))
+                record.version = value;
+            else if (key == QLatin1String("ID_FS_LABEL_ENC"))
+                record.label = decodeFsEncString(value);
+            else if (key == QLatin1String("ID_FS_UUID"))
+                record.uuid = value;
+        }
+    }
+
+    QMutexLocker locker(&m_ProbeMutex);
+    if (m_ProbeScans > 0)
+        m_Probes.insert(deviceNode, record);
+
+    return record;
+}
+
+QString SfdiskBackend::readLabel(const QString& deviceNode) const
+{
+    return probe(deviceNode).label;
+}
+
+QString SfdiskBackend::readUUID(const QString& deviceNode) const
+{
+    return probe(deviceNode).uuid;
 }
 
 PartitionTable::Flags SfdiskBackend::availableFlags(PartitionTable::TableType type)
@@ -12,7 +12,10 @@
 #include "core/partition.h"
 #include "fs/filesystem.h"
 
+#include <QHash>
+#include <QJsonObject>
 #include <QList>
+#include <QMutex>
 #include <QVariant>
 
 class Device;
@@ -46,6 +49,21 @@ public:
     QString readUUID(const QString& deviceNode) const override;
 
 private:
+    /** File system signature of a device node as udev sees it */
+    struct ProbeRecord
+    {
+        QString type;
+        QString version;
+        QString label;
+        QString uuid;
+    };
+
+    void beginProbeCache(const QHash<QString, QJsonObject>& blockDevices);
+    void endProbeCache();
+    ProbeRecord probe(const QString& deviceNode) const;
+
+    static QHash<QString, QJsonObject> readBlockDevices(const QStringList& deviceNodes = QStringList());
+    Device* scanDevice(const QString& deviceNode, const QJsonObject& blockDevice);
     static void readSectorsUsed(const Device& d, Partition& p, const QString& mountPoint);
     void scanDevicePartitions(Device& d, const QJsonArray& jsonPartitions);
     Partition* scanPartition(Device& d, const QString& partitionNode, const qint64 firstSector, const qint64 lastSector, const QString& partitionType, const bool bootable);
@@ -55,6 +73,11 @@ private:
     static PartitionTable::Flags availableFlags(PartitionTable::TableType type);
     static FileSystem::Type fileSystemNameToType(const QString& fileSystemName, const QString& version);
     static FileSystem::Type runDetectFileSystemCommand(ExternalCommand& command, QString& typeRegExp, QString& versionRegExp, QString& name);
+
+    // Probe results are only kept while a scan is running, see beginProbeCache()
+    mutable QMutex m_ProbeMutex;
+    mutable QHash<QString, ProbeRecord> m_Probes;
+    int m_ProbeScans = 0;
 };
 
 #endif
@@ -37,12 +37,15 @@ bool SfdiskDevice::openExclusive()
 
 bool SfdiskDevice::close()
 {
+    // Data may have been copied to the device, let udev probe it again
+    const bool written = isExclusive();
     if (isExclusive())
         setExclusive(false);
 
-    CoreBackendPartitionTable* ptable = new SfdiskPartitionTable(m_device);
-    ptable->commit();
-    delete ptable;
+    // Jobs commit the changes they make to the partition table themselves, so
+    // usually there is nothing left to do here
+    if (written || SfdiskPartitionTable::hasChanges(m_device->deviceNode()))
+        SfdiskPartitionTable(m_device).commit();
 
     return true;
 }
@@ -54,6 +57,8 @@ std::unique_ptr<CoreBackendPartitionTable> SfdiskDevice::openPartitionTable()
 
 bool SfdiskDevice::createPartitionTable(Report& report, const PartitionTable& ptable)
 {
+    SfdiskPartitionTable::setChanged(m_device->deviceNode());
+
     QByteArray tableType;
     if (ptable.type() == PartitionTable::msdos || ptable.type() == PartitionTable::msdos_sectorbased)
         tableType = QByteArrayLiteral("dos");
@@ -21,13 +21,20 @@
 #include "util/report.h"
 #include "util/externalcommand.h"
 
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMutex>
 #include <QRegularExpression>
+#include <QSet>
 
 #include <KLocalizedString>
 
+// Devices whose partition table was written to since the last commit
+static QMutex changedMutex;
+static QSet<QString> changedDevices;
+
 SfdiskPartitionTable::SfdiskPartitionTable(const Device* d) :
     CoreBackendPartitionTable(),
     m_device(d)
@@ -43,22 +50,61 @@ bool SfdiskPartitionTable::open()
     return true;
 }
 
+/** Makes the kernel and udev pick up changes to the device.
+
+    The kernel only rereads the partition table if it changed since the last commit. udev is
+    asked to update the device and its partitions in any case, since jobs also commit after
+    writing file system signatures and labels.
+*/
 bool SfdiskPartitionTable::commit(quint32 timeout)
 {
-    if (m_device->type() == Device::Type::SoftwareRAID_Device)
+    const bool changed = takeChanges(m_device->deviceNode());
+    const QString settleTimeout = QStringLiteral("--timeout=") + QString::number(timeout);
+    const bool stopQueue = changed && m_device->type() == Device::Type::SoftwareRAID_Device;
+
+    if (stopQueue)
         ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("control"), QStringLiteral("--stop-exec-queue") }).run();
 
-    ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("settle"), QStringLiteral("--timeout=") + QString::number(timeout) }).run();
-    ExternalCommand(QStringLiteral("partx"), { QStringLiteral("--update"), m_device->deviceNode() }).run();
-    ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("trigger"), QStringLiteral("--subsystem-match=block") }).run();
+    if (changed) {
+        ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("settle"), settleTimeout }).run();
+        ExternalCommand(QStringLiteral("partx"), { QStringLiteral("--update"), m_device->deviceNode() }).run();
+    }
+
+    // Only the device and its partitions, not every block device on the system
+    const QString sysPath = QStringLiteral("/sys/class/block/") + QFileInfo(QFileInfo(m_device->deviceNode()).canonicalFilePath()).fileName();
+    ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("trigger"), QStringLiteral("--subsystem-match=block"), QStringLiteral("--parent-match=") + sysPath }).run();
 
-    if (m_device->type() == Device::Type::SoftwareRAID_Device)
+    if (stopQueue)
         ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("control"), QStringLiteral("--start-exec-queue") }).run();
 
-    ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("settle"), QStringLiteral("--timeout=") + QString::number(timeout) }).run();
+    ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("settle"), settleTimeout }).run();
     return true;
 }
 
+/** Remembers that the partition table of a device was written to.
+    @param deviceNode the device node of the device
+*/
+void SfdiskPartitionTable::setChanged(const QString& deviceNode)
+{
+    QMutexLocker locker(&changedMutex);
+    changedDevices.insert(deviceNode);
+}
+
+/** @param deviceNode the device node of a device
+    @return true if the partition table of the device was written to since the last commit
+*/
+bool SfdiskPartitionTable::hasChanges(const QString& deviceNode)
+{
+    QMutexLocker locker(&changedMutex);
+    return changedDevices.contains(deviceNode);
+}
+
+bool SfdiskPartitionTable::takeChanges(const QString& deviceNode)
+{
+    QMutexLocker locker(&changedMutex);
+    return changedDevices.remove(deviceNode);
+}
+
 QString SfdiskPartitionTable::createPartition(Report& report, const Partition& partition)
 {
     if ( !(partition.roles().has(PartitionRole::Extended) || partition.roles().has(PartitionRole::Logical) || partition.roles().has(PartitionRole::Primary) ) ) {
@@ -66,6 +112,8 @@ QString SfdiskPartitionTable::createPartition(Report& report, const Partition& p
         return QString();
     }
 
+    setChanged(m_device->deviceNode());
+
     QByteArray type = QByteArray();
     if (partition.roles().has(PartitionRole::Extended))
         type = QByteArrayLiteral(" type=5");
@@ -93,6 +141,8 @@ QString SfdiskPartitionTable::createPartition(Report& report, const Partition& p
 
 bool SfdiskPartitionTable::deletePartition(Report& report, const Partition& partition)
 {
+    setChanged(m_device->deviceNode());
+
     ExternalCommand deleteCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--force"), QStringLiteral("--delete"), partition.devicePath(), QString::number(partition.number()) } );
     if (deleteCommand.run(-1) && deleteCommand.exitCode() == 0)
         return true;
@@ -103,6 +153,8 @@ bool SfdiskPartitionTable::deletePartition(Report& report, const Partition& part
 
 bool SfdiskPartitionTable::updateGeometry(Report& report, const Partition& partition, qint64 sectorStart, qint64 sectorEnd)
 {
+    setChanged(m_device->deviceNode());
+
     ExternalCommand sfdiskCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--force"), partition.devicePath(), QStringLiteral("-N"), QString::number(partition.number()) } );
     if ( sfdiskCommand.write(QByteArrayLiteral("start=") + QByteArray::number(sectorStart) +
                                                         QByteArrayLiteral(" size=") + QByteArray::number(sectorEnd - sectorStart + 1) +
@@ -209,6 +261,7 @@ bool SfdiskPartitionTable::setPartitionLabel(Report& report, const Partition& pa
 {
     if (label.isEmpty())
         return true;
+    setChanged(m_device->deviceNode());
     ExternalCommand sfdiskCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--part-label"), m_device->deviceNode(), QString::number(partition.number()),
                 label } );
     return sfdiskCommand.run(-1) && sfdiskCommand.exitCode() == 0;
@@ -233,6 +286,7 @@ bool SfdiskPartitionTable::setPartitionUUID(Report& report, const Partition& par
 {
     if (uuid.isEmpty())
         return true;
+    setChanged(m_device->deviceNode());
     ExternalCommand sfdiskCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--part-uuid"), m_device->deviceNode(), QString::number(partition.number()),
                 uuid } );
     return sfdiskCommand.run(-1) && sfdiskCommand.exitCode() == 0;
@@ -243,6 +297,7 @@ bool SfdiskPartitionTable::setPartitionAttributes(Report& report, const Partitio
     QStringList attributes = SfdiskGptAttributes::toStringList(attrs);
     if (attributes.isEmpty())
         return true;
+    setChanged(m_device->deviceNode());
     ExternalCommand sfdiskCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--part-attrs"), m_device->deviceNode(), QString::number(partition.number()),
                 attributes.join(QStringLiteral(",")) } );
     return sfdiskCommand.run(-1) && sfdiskCommand.exitCode() == 0;
@@ -255,6 +310,7 @@ bool SfdiskPartitionTable::setPartitionSystemType(Report& report, const Partitio
         partitionType = getPartitionType(partition.fileSystem().type(), m_device->partitionTable()->type());
     if (partitionType.isEmpty())
         return true;
+    setChanged(m_device->deviceNode());
     ExternalCommand sfdiskCommand(report, QStringLiteral("sfdisk"), { QStringLiteral("--part-type"), m_device->deviceNode(), QString::number(partition.number()),
                 partitionType } );
     return sfdiskCommand.run(-1) && sfdiskCommand.exitCode() == 0;
@@ -262,6 +318,8 @@ bool SfdiskPartitionTable::setPartitionSystemType(Report& report, const Partitio
 
 bool SfdiskPartitionTable::setFlag(Report& report, const Partition& partition, PartitionTable::Flag flag, bool state)
 {
+    setChanged(m_device->deviceNode());
+
     if (m_device->partitionTable()->type() == PartitionTable::TableType::msdos ||
          m_device->partitionTable()->type() == PartitionTable::TableType::msdos_sectorbased) {
         // We only allow setting one active partition per device
@@ -13,6 +13,7 @@
 
 #include "fs/filesystem.h"
 
+#include <QString>
 #include <QtGlobal>
 
 class CoreBackendPartition;
@@ -43,7 +44,12 @@ public:
     bool setPartitionSystemType(Report& report, const Partition& partition) override;
     bool setFlag(Report& report, const Partition& partition, PartitionTable::Flag flag, bool state) override;
 
+    static void setChanged(const QString& deviceNode);
+    static bool hasChanges(const QString& deviceNode);
+
 private:
+    static bool takeChanges(const QString& deviceNode);
+
     const Device *m_device;
 };
 
@@ -0,0 +1,161 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/chacha20.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <sys/random.h>
+
+#include <QThread>
+
+// Buffers are only split between threads in slices of at least this size
+constexpr qint64 minimumSlice = 4 << 20;
+
+/** Seeds a new generator from the kernel. */
+ChaCha20Stream::ChaCha20Stream()
+{
+    // "expand 32-byte k"
+    m_State[0] = 0x61707865;
+    m_State[1] = 0x3320646e;
+    m_State[2] = 0x79622d32;
+    m_State[3] = 0x6b206574;
+
+    // 256 bit key and 64 bit nonce, the block counter in words 12 and 13 starts at 0
+    uint32_t seed[10];
+    if (getrandom(seed, sizeof(seed), 0) != sizeof(seed))
+        return;
+
+    memcpy(m_State + 4, seed, 8 * sizeof(uint32_t));
+    m_State[12] = 0;
+    m_State[13] = 0;
+    m_State[14] = seed[8];
+    m_State[15] = seed[9];
+    m_Valid = true;
+}
+
+/** Creates a generator with a fixed key, so that its output can be checked.
+    @param key 256 bit key
+    @param counter block counter of the first block
+    @param nonce 64 bit nonce
+*/
+ChaCha20Stream::ChaCha20Stream(const uint32_t key[8], uint64_t counter, uint64_t nonce)
+{
+    m_State[0] = 0x61707865;
+    m_State[1] = 0x3320646e;
+    m_State[2] = 0x79622d32;
+    m_State[3] = 0x6b206574;
+
+    memcpy(m_State + 4, key, 8 * sizeof(uint32_t));
+    m_State[12] = static_cast<uint32_t>(counter);
+    m_State[13] = static_cast<uint32_t>(counter >> 32);
+    m_State[14] = static_cast<uint32_t>(nonce);
+    m_State[15] = static_cast<uint32_t>(nonce >> 32);
+    m_Valid = true;
+}
+
+/** Computes lanes blocks of keystream.
+    @param counter block counter of the first block
+    @param out memory for lanes * 16 words
+*/
+void ChaCha20Stream::generate(uint64_t counter, uint32_t* out) const
+{
+    // One vector per state word with one element per block, so every operation of
+    // the rounds works on all blocks at once. GCC and Clang map this to SSE2/AVX2/NEON.
+    typedef uint32_t Lanes __attribute__((vector_size(lanes * sizeof(uint32_t))));
+
+    Lanes x[16];
+    for (int i = 0; i < 16; ++i)
+        x[i] = Lanes{} + m_State[i];
+
+    for (int l = 0; l < lanes; ++l) {
+        x[12][l] = static_cast<uint32_t>(counter + l);
+        x[13][l] = static_cast<uint32_t>((counter + l) >> 32);
+    }
+
+    Lanes input[16];
+    memcpy(input, x, sizeof(x));
+
+#define KPMCORE_CHACHA_QUARTERROUND(a, b, c, d) \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = (x[d] << 16) | (x[d] >> 16); \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = (x[b] << 12) | (x[b] >> 20); \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = (x[d] << 8) | (x[d] >> 24); \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = (x[b] << 7) | (x[b] >> 25);
+
+    for (int round = 0; round < 10; ++round) {
+        KPMCORE_CHACHA_QUARTERROUND(0, 4, 8, 12)
+        KPMCORE_CHACHA_QUARTERROUND(1, 5, 9, 13)
+        KPMCORE_CHACHA_QUARTERROUND(2, 6, 10, 14)
+        KPMCORE_CHACHA_QUARTERROUND(3, 7, 11, 15)
+        KPMCORE_CHACHA_QUARTERROUND(0, 5, 10, 15)
+        KPMCORE_CHACHA_QUARTERROUND(1, 6, 11, 12)
+        KPMCORE_CHACHA_QUARTERROUND(2, 7, 8, 13)
+        KPMCORE_CHACHA_QUARTERROUND(3, 4, 9, 14)
+    }
+
+#undef KPMCORE_CHACHA_QUARTERROUND
+
+    for (int i = 0; i < 16; ++i)
+        x[i] += input[i];
+
+    // The registers hold the blocks interleaved word by word, write them one after the other
+    for (int l = 0; l < lanes; ++l)
+        for (int i = 0; i < 16; ++i)
+            out[l * 16 + i] = x[i][l];
+}
+
+/** Fills buffer with keystream starting at the given block counter.
+    @param buffer memory of at least size bytes
+    @param size number of bytes to generate
+    @param counter block counter of the first block
+*/
+void ChaCha20Stream::fillBlocks(char* buffer, qint64 size, uint64_t counter) const
+{
+    constexpr qint64 stride = lanes * 64;
+
+    // Keystream comes in strides of lanes blocks, the last one may be cut short.
+    uint32_t block[lanes * 16];
+    for (qint64 pos = 0; pos < size; pos += stride, counter += lanes) {
+        generate(counter, block);
+        memcpy(buffer + pos, block, qMin(stride, size - pos));
+    }
+}
+
+/** Fills buffer with the next size bytes of random data.
+    @param buffer memory of at least size bytes
+    @param size number of bytes to generate
+*/
+void ChaCha20Stream::fill(char* buffer, qint64 size)
+{
+    uint64_t counter = (static_cast<uint64_t>(m_State[13]) << 32) | m_State[12];
+
+    // Every thread takes a slice of whole groups of lanes blocks and starts at the counter
+    // of its first block, so no two threads produce the same keystream.
+    const qint64 blocks = (size + 63) / 64;
+    const int threads = static_cast<int>(qBound<qint64>(1, size / minimumSlice, QThread::idealThreadCount()));
+    const qint64 sliceBlocks = ((blocks + threads - 1) / threads + lanes - 1) / lanes * lanes;
+
+    std::vector<std::unique_ptr<QThread>> workers;
+    for (int i = 1; i < threads; ++i) {
+        const qint64 offset = i * sliceBlocks * 64;
+        if (offset >= size)
+            break;
+        workers.emplace_back(QThread::create([=] {
+            fillBlocks(buffer + offset, qMin(sliceBlocks * 64, size - offset), counter + i * sliceBlocks);
+        }));
+        workers.back()->start();
+    }
+
+    fillBlocks(buffer, qMin(sliceBlocks * 64, size), counter);
+    for (auto& worker : workers)
+        worker->wait();
+
+    counter += threads * sliceBlocks;
+    m_State[12] = static_cast<uint32_t>(counter);
+    m_State[13] = static_cast<uint32_t>(counter >> 32);
+}
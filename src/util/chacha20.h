@@ -0,0 +1,48 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_CHACHA20_H
+#define KPMCORE_CHACHA20_H
+
+#include <cstdint>
+
+#include <QtGlobal>
+
+/** ChaCha20 keystream generator used by the helper to shred with random data.
+
+    The key and nonce are taken once from the kernel with getrandom(), after that
+    random data is produced without any system calls. Several blocks are computed
+    side by side in SIMD registers, and large buffers are split between threads.
+
+    The keystream is that of ChaCha20 with a 64 bit block counter in state words 12
+    and 13 and a 64 bit nonce in words 14 and 15, serialized in host byte order.
+*/
+class ChaCha20Stream
+{
+    Q_DISABLE_COPY(ChaCha20Stream)
+
+public:
+    ChaCha20Stream();
+    ChaCha20Stream(const uint32_t key[8], uint64_t counter, uint64_t nonce);
+
+    bool isValid() const {
+        return m_Valid; /**< @return true if the generator could be seeded */
+    }
+
+    void fill(char* buffer, qint64 size);
+
+private:
+    // Number of 64 byte blocks computed at once, fits 128 bit registers
+    static constexpr int lanes = 4;
+
+    void generate(uint64_t counter, uint32_t* out) const;
+    void fillBlocks(char* buffer, qint64 size, uint64_t counter) const;
+
+    uint32_t m_State[16];
+    bool m_Valid = false;
+};
+
+#endif
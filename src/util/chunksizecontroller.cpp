@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/chunksizecontroller.h"
+
+// A phase needs at least this many chunks and this much time to give a usable measurement
+constexpr int phaseChunks = 4;
+constexpr qint64 phaseMilliseconds = 1000;
+// Smaller gains than this are treated as noise
+constexpr double minimumGain = 1.05;
+
+/** Creates a new controller.
+    @param initialSize the chunk size to start with
+    @param granularity every chunk size is a multiple of this
+    @param maxSize chunk sizes never exceed this
+    @param adaptive if false, initialSize is used for the whole copy
+*/
+ChunkSizeController::ChunkSizeController(qint64 initialSize, qint64 granularity, qint64 maxSize, bool adaptive) :
+    m_Granularity(qMax<qint64>(granularity, 1)),
+    m_MaxMultiple(qMax<qint64>(maxSize / m_Granularity, 1)),
+    m_Size(initialSize),
+    m_Settled(!adaptive),
+    m_Multiple(qBound<qint64>(1, initialSize / m_Granularity, m_MaxMultiple))
+{
+    if (adaptive)
+        setMultiple(m_Multiple);
+}
+
+/** Records a chunk that was written.
+    @param chunkSize size of the chunk
+    @return true if this finished a measurement phase, see phases()
+*/
+bool ChunkSizeController::chunkFinished(qint64 chunkSize)
+{
+    if (m_Settled)
+        return false;
+
+    // Chunks that were already in flight when the size changed, and the short last chunk,
+    // do not belong to the current phase.
+    if (chunkSize != size())
+        return false;
+
+    // The phase starts when its first chunk completes, so that chunk only starts the clock.
+    if (!m_PhaseTimer.isValid()) {
+        m_PhaseTimer.start();
+        return false;
+    }
+
+    m_PhaseBytes += chunkSize;
+    if (++m_PhaseChunks < phaseChunks || m_PhaseTimer.elapsed() < phaseMilliseconds)
+        return false;
+
+    const double throughput = m_PhaseBytes * 1000.0 / (1 << 20) / m_PhaseTimer.elapsed();
+    m_Phases.append({ size(), throughput });
+
+    if (throughput > m_BestThroughput * minimumGain) {
+        m_BestThroughput = throughput;
+        m_BestMultiple = m_Multiple;
+    } else if (m_Phases.size() == 2 && m_BestMultiple > 1) {
+        // Growing did not help right away, try the other direction from the initial size.
+        m_Direction = -1;
+        m_Multiple = m_BestMultiple;
+    } else {
+        settle();
+        return true;
+    }
+
+    const qint64 next = m_Direction > 0 ? m_Multiple * 2 : m_Multiple / 2;
+    if (next < 1 || next > m_MaxMultiple) {
+        settle();
+        return true;
+    }
+
+    setMultiple(next);
+    return true;
+}
+
+void ChunkSizeController::setMultiple(qint64 multiple)
+{
+    m_Multiple = multiple;
+    m_Size = m_Multiple * m_Granularity;
+    m_PhaseTimer.invalidate();
+    m_PhaseBytes = 0;
+    m_PhaseChunks = 0;
+}
+
+void ChunkSizeController::settle()
+{
+    m_Settled = true;
+    if (m_BestMultiple > 0)
+        setMultiple(m_BestMultiple);
+}
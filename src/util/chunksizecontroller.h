@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_CHUNKSIZECONTROLLER_H
+#define KPMCORE_CHUNKSIZECONTROLLER_H
+
+#include <atomic>
+
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtGlobal>
+
+/** Picks the chunk size for a copy in the helper from measured throughput.
+
+    The copy starts with the size suggested by the caller, usually derived from the
+    optimal I/O size of the devices involved. Throughput is measured over a phase of
+    several chunks, then the size is doubled while that keeps helping. If the first
+    step up does not help, halving is tried instead. Once neither direction improves
+    throughput the best size measured is kept for the rest of the copy.
+
+    Sizes are always a multiple of the granularity and never exceed the maximum size,
+    which is the size of the copy buffers.
+
+    size() may be called from any thread, chunkFinished() only from one thread.
+*/
+class ChunkSizeController
+{
+    Q_DISABLE_COPY(ChunkSizeController)
+
+public:
+    /** Throughput measured with one chunk size */
+    struct Phase
+    {
+        qint64 chunkSize;
+        double mibPerSecond;
+    };
+
+    ChunkSizeController(qint64 initialSize, qint64 granularity, qint64 maxSize, bool adaptive);
+
+    qint64 size() const {
+        return m_Size.load(); /**< @return the size to use for the next chunk */
+    }
+    bool isSettled() const {
+        return m_Settled; /**< @return true if the size no longer changes */
+    }
+    const QVector<Phase>& phases() const {
+        return m_Phases; /**< @return throughput of all finished measurement phases */
+    }
+
+    bool chunkFinished(qint64 chunkSize);
+
+private:
+    void setMultiple(qint64 multiple);
+    void settle();
+
+    const qint64 m_Granularity;
+    const qint64 m_MaxMultiple;
+    std::atomic<qint64> m_Size;
+    bool m_Settled;
+
+    qint64 m_Multiple;
+    qint64 m_BestMultiple = 0;
+    double m_BestThroughput = 0;
+    int m_Direction = 1;
+
+    QElapsedTimer m_PhaseTimer;
+    qint64 m_PhaseBytes = 0;
+    int m_PhaseChunks = 0;
+    QVector<Phase> m_Phases;
+};
+
+#endif
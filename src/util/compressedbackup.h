@@ -0,0 +1,184 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_COMPRESSEDBACKUP_H
+#define KPMCORE_COMPRESSEDBACKUP_H
+
+#include <cstring>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtEndian>
+#include <QtGlobal>
+
+/** Layout of compressed backup images.
+
+    A compressed backup is a valid zstd stream, so "zstd -d" turns it back into a raw image:
+    - a skippable frame with the Header,
+    - one zstd frame per copied chunk, each with a content checksum,
+    - a seek table in the zstd seekable format, which lists compressed size, decompressed size
+      and checksum of every frame, so that frames can be located without decompressing them.
+      Its first entry is the header frame, which decompresses to nothing, so that offsets
+      summed up from the start of the file as the format describes point at the frames.
+
+    All integers are little endian. This header is shared between the library and the helper.
+*/
+namespace CompressedBackup
+{
+
+// zstd skips frames with magic numbers 0x184D2A50 to 0x184D2A5F
+constexpr quint32 headerFrameMagic = 0x184D2A5B;
+constexpr quint32 seekTableFrameMagic = 0x184D2A5E;
+constexpr quint32 seekTableFooterMagic = 0x8F92EAB1;
+constexpr quint8 seekTableChecksumFlag = 0x80;
+
+constexpr char signature[8] = { 'K', 'P', 'M', 'B', 'A', 'C', 'K', '1' };
+constexpr quint32 formatVersion = 1;
+
+// frame magic + frame size + signature + version + sector size + source length + file system type + reserved
+constexpr int headerFrameSize = 4 + 4 + 8 + 4 + 4 + 8 + 4 + 4;
+constexpr int seekTableEntrySize = 12;
+constexpr int seekTableFooterSize = 9;
+
+// Lower 32 bits of the XXH64 checksum of no data, for the seek table entry of the header frame
+constexpr quint32 emptyChecksum = 0x51D8E999;
+
+struct Header
+{
+    qint64 sourceLength = 0;   /**< number of bytes of the original data */
+    quint32 sectorSize = 0;    /**< logical sector size of the device the data was read from */
+    qint32 fileSystemType = 0; /**< FileSystem::Type of the backed up file system */
+};
+
+struct Frame
+{
+    quint32 compressedSize = 0;
+    quint32 decompressedSize = 0;
+    quint32 checksum = 0; /**< lower 32 bits of the XXH64 content checksum of the frame */
+};
+
+/** @return the skippable frame holding @p header */
+inline QByteArray serializeHeader(const Header& header)
+{
+    QByteArray data(headerFrameSize, 0);
+    char* p = data.data();
+    qToLittleEndian<quint32>(headerFrameMagic, p);
+    qToLittleEndian<quint32>(headerFrameSize - 8, p + 4);
+    memcpy(p + 8, signature, sizeof(signature));
+    qToLittleEndian<quint32>(formatVersion, p + 16);
+    qToLittleEndian<quint32>(header.sectorSize, p + 20);
+    qToLittleEndian<qint64>(header.sourceLength, p + 24);
+    qToLittleEndian<qint32>(header.fileSystemType, p + 32);
+    return data;
+}
+
+/** Parses the header at the start of a compressed backup.
+    @param data the first headerFrameSize bytes of the file
+    @param header filled in on success
+    @return true if @p data is the header of a compressed backup
+*/
+inline bool parseHeader(const QByteArray& data, Header& header)
+{
+    if (data.size() < headerFrameSize)
+        return false;
+
+    const char* p = data.constData();
+    if (qFromLittleEndian<quint32>(p) != headerFrameMagic || qFromLittleEndian<quint32>(p + 4) != headerFrameSize - 8
+            || memcmp(p + 8, signature, sizeof(signature)) != 0 || qFromLittleEndian<quint32>(p + 16) != formatVersion)
+        return false;
+
+    header.sectorSize = qFromLittleEndian<quint32>(p + 20);
+    header.sourceLength = qFromLittleEndian<qint64>(p + 24);
+    header.fileSystemType = qFromLittleEndian<qint32>(p + 32);
+    return header.sourceLength >= 0;
+}
+
+/** Reads the header of a compressed backup file.
+    @param fileName the file to read
+    @param header filled in on success
+    @return true if @p fileName is a compressed backup
+*/
+inline bool readHeader(const QString& fileName, Header& header)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) && parseHeader(file.read(headerFrameSize), header);
+}
+
+/** @return the skippable frame holding the seek table for @p frames, which do not include the header frame */
+inline QByteArray serializeSeekTable(const std::vector<Frame>& dataFrames)
+{
+    std::vector<Frame> frames;
+    frames.reserve(dataFrames.size() + 1);
+    frames.push_back({ headerFrameSize, 0, emptyChecksum });
+    frames.insert(frames.end(), dataFrames.begin(), dataFrames.end());
+
+    const qint64 payloadSize = static_cast<qint64>(frames.size()) * seekTableEntrySize + seekTableFooterSize;
+    QByteArray data(8 + payloadSize, 0);
+    char* p = data.data();
+    qToLittleEndian<quint32>(seekTableFrameMagic, p);
+    qToLittleEndian<quint32>(static_cast<quint32>(payloadSize), p + 4);
+    p += 8;
+
+    for (const Frame& frame : frames) {
+        qToLittleEndian<quint32>(frame.compressedSize, p);
+        qToLittleEndian<quint32>(frame.decompressedSize, p + 4);
+        qToLittleEndian<quint32>(frame.checksum, p + 8);
+        p += seekTableEntrySize;
+    }
+
+    qToLittleEndian<quint32>(static_cast<quint32>(frames.size()), p);
+    p[4] = static_cast<char>(seekTableChecksumFlag);
+    qToLittleEndian<quint32>(seekTableFooterMagic, p + 5);
+    return data;
+}
+
+/** Reads the seek table at the end of a compressed backup.
+    @param file the open backup file
+    @param frames filled in with all frames after the header frame in file order
+    @return true on success
+*/
+inline bool readSeekTable(QFile& file, std::vector<Frame>& frames)
+{
+    const qint64 fileSize = file.size();
+    if (fileSize < headerFrameSize + 8 + seekTableFooterSize || !file.seek(fileSize - seekTableFooterSize))
+        return false;
+
+    const QByteArray footer = file.read(seekTableFooterSize);
+    if (footer.size() != seekTableFooterSize || qFromLittleEndian<quint32>(footer.constData() + 5) != seekTableFooterMagic
+            || !(static_cast<quint8>(footer[4]) & seekTableChecksumFlag))
+        return false;
+
+    const qint64 count = qFromLittleEndian<quint32>(footer.constData());
+    const qint64 tableSize = 8 + count * seekTableEntrySize + seekTableFooterSize;
+    if (tableSize > fileSize - headerFrameSize || !file.seek(fileSize - tableSize))
+        return false;
+
+    const QByteArray table = file.read(tableSize - seekTableFooterSize);
+    if (table.size() != tableSize - seekTableFooterSize || qFromLittleEndian<quint32>(table.constData()) != seekTableFrameMagic
+            || qFromLittleEndian<quint32>(table.constData() + 4) != tableSize - 8)
+        return false;
+
+    frames.resize(count);
+    const char* p = table.constData() + 8;
+    for (Frame& frame : frames) {
+        frame.compressedSize = qFromLittleEndian<quint32>(p);
+        frame.decompressedSize = qFromLittleEndian<quint32>(p + 4);
+        frame.checksum = qFromLittleEndian<quint32>(p + 8);
+        p += seekTableEntrySize;
+    }
+
+    // Backups written before the header frame had an entry start with the first data frame
+    if (!frames.empty() && frames.front().compressedSize == headerFrameSize && frames.front().decompressedSize == 0)
+        frames.erase(frames.begin());
+
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/copypipeline.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include <cstdlib>
+#include <cstring>
+
+constexpr size_t bufferAlignment = 4096;
+
+void AlignedBufferDeleter::operator()(char* p) const
+{
+    free(p);
+}
+
+/** Allocates a page aligned buffer.
+    @param size size of the buffer in bytes
+    @return the buffer or nullptr if out of memory
+*/
+AlignedBuffer allocateAlignedBuffer(qint64 size)
+{
+    void *p = nullptr;
+    if (posix_memalign(&p, bufferAlignment, static_cast<size_t>(size)) != 0)
+        return nullptr;
+
+    return AlignedBuffer(static_cast<char*>(p));
+}
+
+/** Checks whether a buffer only contains zeros.
+
+    Works on 64 byte blocks with independent 64-bit accumulators, which compilers turn
+    into SIMD code, and stops at the first block that contains data.
+
+    @param data the buffer to check
+    @param size size of the buffer in bytes
+    @return true if all bytes are zero
+*/
+bool isAllZero(const char* data, qint64 size)
+{
+    qint64 i = 0;
+    for (; i + 64 <= size; i += 64) {
+        quint64 words[8];
+        memcpy(words, data + i, sizeof(words));
+        if ((words[0] | words[1] | words[2] | words[3] | words[4] | words[5] | words[6] | words[7]) != 0)
+            return false;
+    }
+
+    for (; i < size; ++i) {
+        if (data[i] != 0)
+            return false;
+    }
+
+    return true;
+}
+
+/** Creates a new pipeline and preallocates its buffers.
+    @param bufferCount number of buffers in the ring, at least two
+    @param bufferSize size of each buffer in bytes
+*/
+CopyPipeline::CopyPipeline(int bufferCount, qint64 bufferSize) :
+    m_Buffers(qMax(bufferCount, 2))
+{
+    for (auto &buffer : m_Buffers) {
+        buffer = allocateAlignedBuffer(bufferSize);
+        m_Valid = m_Valid && buffer;
+    }
+}
+
+/** Copies all chunks.
+    @param nextChunk produces the chunks to copy in order, called on the reader thread
+    @param read reads a chunk into the given buffer, called on the reader thread
+    @param write writes a buffer filled by read, called on the calling thread
+    @param finished called after each chunk was written, on the calling thread
+    @return true if every chunk was read and written successfully
+*/
+bool CopyPipeline::run(const NextChunkFunction& nextChunk, const ReadFunction& read, const WriteFunction& write, const FinishedFunction& finished)
+{
+    if (!isValid())
+        return false;
+
+    m_Free.clear();
+    m_Filled.clear();
+    m_Aborted = false;
+    for (int i = 0; i < bufferCount(); ++i)
+        m_Free.enqueue(i);
+
+    std::unique_ptr<QThread> reader(QThread::create([&] { readerLoop(nextChunk, read); }));
+    reader->start();
+
+    bool rval = true;
+    while (true) {
+        Filled filled;
+        {
+            QMutexLocker locker(&m_Mutex);
+            while (m_Filled.isEmpty())
+                m_FilledAvailable.wait(&m_Mutex);
+            filled = m_Filled.dequeue();
+        }
+
+        if (filled.slot < 0)
+            break;
+
+        if (!filled.success || !write(m_Buffers[filled.slot].get(), filled.chunk)) {
+            rval = false;
+            break;
+        }
+
+        {
+            QMutexLocker locker(&m_Mutex);
+            m_Free.enqueue(filled.slot);
+        }
+        m_FreeAvailable.wakeOne();
+
+        finished(filled.chunk);
+    }
+
+    if (!rval)
+        abort();
+
+    reader->wait();
+    return rval;
+}
+
+void CopyPipeline::readerLoop(const NextChunkFunction& nextChunk, const ReadFunction& read)
+{
+    while (true) {
+        int slot;
+        {
+            QMutexLocker locker(&m_Mutex);
+            while (m_Free.isEmpty() && !m_Aborted)
+                m_FreeAvailable.wait(&m_Mutex);
+            if (m_Aborted)
+                return;
+            slot = m_Free.dequeue();
+        }
+
+        CopyChunk chunk = { 0, 0, 0 };
+        const bool more = nextChunk(chunk);
+        const bool success = more && read(m_Buffers[slot].get(), chunk);
+
+        {
+            QMutexLocker locker(&m_Mutex);
+            m_Filled.enqueue({more ? slot : -1, success, chunk});
+        }
+        m_FilledAvailable.wakeOne();
+
+        // The writer stops at the first failed chunk, nothing more to read.
+        if (!success)
+            return;
+    }
+}
+
+void CopyPipeline::abort()
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Aborted = true;
+    m_FreeAvailable.wakeAll();
+}
@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_COPYPIPELINE_H
+#define KPMCORE_COPYPIPELINE_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+/** A single block of a copy: where it is read from, where it goes and how large it is. */
+struct CopyChunk
+{
+    qint64 readOffset;
+    qint64 writeOffset;
+    qint64 size;
+};
+
+struct AlignedBufferDeleter
+{
+    void operator()(char* p) const;
+};
+
+/** A page aligned buffer, suitable for O_DIRECT I/O on any sector size. */
+using AlignedBuffer = std::unique_ptr<char, AlignedBufferDeleter>;
+
+AlignedBuffer allocateAlignedBuffer(qint64 size);
+
+bool isAllZero(const char* data, qint64 size);
+
+/** Pipelined copy engine used by the helper.
+
+    A reader stage and a writer stage run concurrently and are joined by a bounded ring
+    of preallocated buffers. Chunks are produced one after another by a NextChunkFunction,
+    so their size may change during the copy, but never beyond the buffer size.
+    The reader fills free buffers in chunk order and the writer
+    drains them in exactly the same order, so chunk n is never written before chunks
+    0..n have been read. Callers that move data within one device rely on this: as long
+    as the chunk order follows the CopyDirection rules, a write can only clobber source
+    data that has already been read into the ring.
+
+    Buffers are page aligned, so the read and write functions may use file descriptors
+    opened with O_DIRECT.
+
+    Reading happens on a worker thread, writing and the per chunk callback happen on the
+    thread that calls run().
+*/
+class CopyPipeline
+{
+    Q_DISABLE_COPY(CopyPipeline)
+
+public:
+    /** Stores the next chunk to copy in chunk and returns true, or returns false when done. */
+    using NextChunkFunction = std::function<bool(CopyChunk& chunk)>;
+    using ReadFunction = std::function<bool(char* buffer, const CopyChunk& chunk)>;
+    using WriteFunction = std::function<bool(const char* buffer, const CopyChunk& chunk)>;
+    using FinishedFunction = std::function<void(const CopyChunk& chunk)>;
+
+    CopyPipeline(int bufferCount, qint64 bufferSize);
+
+    bool isValid() const {
+        return m_Valid; /**< @return true if all buffers could be allocated */
+    }
+
+    bool run(const NextChunkFunction& nextChunk, const ReadFunction& read, const WriteFunction& write, const FinishedFunction& finished);
+
+    int bufferCount() const {
+        return static_cast<int>(m_Buffers.size()); /**< @return number of buffers in the ring */
+    }
+
+private:
+    struct Filled
+    {
+        int slot; // -1 marks the end of the copy
+        bool success;
+        CopyChunk chunk;
+    };
+
+    void readerLoop(const NextChunkFunction& nextChunk, const ReadFunction& read);
+    void abort();
+
+    std::vector<AlignedBuffer> m_Buffers;
+    bool m_Valid = true;
+
+    QMutex m_Mutex;
+    QWaitCondition m_FreeAvailable;
+    QWaitCondition m_FilledAvailable;
+    QQueue<int> m_Free;
+    QQueue<Filled> m_Filled;
+    bool m_Aborted = false;
+};
+
+#endif
@@ -19,17 +19,24 @@
 #include "core/copytarget.h"
 #include "core/copytargetbytearray.h"
 #include "core/copysourcedevice.h"
+#include "core/copysourcefile.h"
+#include "core/copysourceshred.h"
 #include "core/copytargetdevice.h"
+#include "core/copytargetfile.h"
 #include "util/globallog.h"
+#include "util/helpersession.h"
 #include "util/report.h"
 
-#include "externalcommandhelper_interface.h"
+#include <memory>
+#include <numeric>
 
 #include <QCryptographicHash>
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusReply>
-#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
 #include <QtGlobal>
 #include <QStandardPaths>
 #include <QString>
@@ -40,6 +47,38 @@
 #include <KJob>
 #include <KLocalizedString>
 
+constexpr qint64 MiB = 1 << 20;
+// Initial chunk size for copyBlocks, rounded up to the granularity of the devices
+constexpr qint64 minimumChunkSize = 4 * MiB;
+// Larger request granularities are ignored, chunks would get too large for the helper
+constexpr qint64 maximumChunkGranularity = 16 * MiB;
+// Reports stop taking output of a command beyond this size, e.g. from badly corrupted file systems
+constexpr qint64 maximumReportedOutput = 10 * MiB;
+// Streamed output is kept up to this size, the same as in the helper. Only its end is kept.
+constexpr qint64 maximumRetainedOutput = 4 * MiB;
+
+/** Lets the signals of the helper session reach a command that waits for its reply without an
+    event loop. The signals are emitted in the main thread and handled there, through direct
+    connections, while the command may wait in any thread. Once the reply is there, detach()
+    waits for a signal that is being handled and keeps all later ones away from the command.
+*/
+struct HelperSignalGuard
+{
+    explicit HelperSignalGuard(ExternalCommand* c) : command(c) {}
+
+    void detach()
+    {
+        QMutexLocker locker(&mutex);
+        command = nullptr;
+        for (const auto& c : std::as_const(connections))
+            QObject::disconnect(c);
+    }
+
+    QMutex mutex;
+    ExternalCommand* command;
+    QList<QMetaObject::Connection> connections;
+};
+
 struct ExternalCommandPrivate
 {
     Report *m_Report;
@@ -49,6 +88,10 @@ struct ExternalCommandPrivate
     QByteArray m_Output;
     QByteArray m_Input;
     QProcess::ProcessChannelMode processChannelMode;
+    ExternalCommand::ProgressParser m_ProgressParser;
+    QByteArray m_PartialLine;
+    qint64 m_StreamedBytes = 0;
+    qint64 m_ReportedBytes = 0;
 };
 
 /** Creates a new ExternalCommand instance without Report.
@@ -107,6 +150,120 @@ bool ExternalCommand::start(int timeout)
     if (command().isEmpty())
         return false;
 
+    const QString cmd = prepare();
+
+    if (!HelperSession::self()->isConnected())
+        return false;
+
+    if (report() || d->m_ProgressParser)
+        return stream(cmd);
+
+    // Nothing is reported while the command runs, so waiting does not need an event loop.
+    const QVariantMap reply = HelperSession::self()->runCommand(cmd, args(), d->m_Input, d->processChannelMode).get();
+    if (reply.isEmpty())
+        return false;
+
+    d->m_Output = reply[QStringLiteral("output")].toByteArray();
+    setExitCode(reply[QStringLiteral("exitCode")].toInt());
+    return reply[QStringLiteral("success")].toBool();
+}
+
+/** Runs the command with its output sent back while it runs, to fill the Report and to
+    follow the progress of the command.
+    @param cmd full path of the command
+    @return true on success
+*/
+bool ExternalCommand::stream(const QString& cmd)
+{
+    HelperSession* session = HelperSession::self();
+    const QString streamId = HelperSession::newStreamId();
+
+    // The output is put together from what arrives, the reply only holds its end
+    d->m_Output.clear();
+    d->m_PartialLine.clear();
+    d->m_StreamedBytes = 0;
+    d->m_ReportedBytes = 0;
+
+    // Output is handled in the main thread while this thread waits. If this is the main
+    // thread, it all arrives with the reply.
+    auto guard = std::make_shared<HelperSignalGuard>(this);
+    guard->connections << connect(session, &HelperSession::commandOutput, session, [guard, streamId] (const QString& id, const QByteArray& output) {
+        QMutexLocker locker(&guard->mutex);
+        if (id == streamId && guard->command)
+            guard->command->onReadOutput(output);
+    }, Qt::DirectConnection);
+
+    QDBusPendingCall pcall = session->call(&OrgKdeKpmcoreExternalcommandInterface::StreamCommand, cmd, args(), d->m_Input, d->processChannelMode, streamId);
+    pcall.waitForFinished();
+    guard->detach();
+
+    if (pcall.isError()) {
+        qWarning() << pcall.error();
+        return false;
+    }
+
+    QDBusPendingReply<QVariantMap> reply = pcall;
+    const QVariantMap result = reply.value();
+    setExitCode(result[QStringLiteral("exitCode")].toInt());
+
+    // Whatever did not arrive through signals in time is at the end of the retained output.
+    const QByteArray retained = result[QStringLiteral("output")].toByteArray();
+    const qint64 missing = result[QStringLiteral("outputSize")].toLongLong() - d->m_StreamedBytes;
+    if (missing > retained.size())
+        qWarning() << "Lost" << missing - retained.size() << "bytes of output of" << cmd;
+    if (missing > 0)
+        onReadOutput(retained.right(qMin<qint64>(missing, retained.size())));
+    if (!d->m_PartialLine.isEmpty())
+        addOutputLine(QString::fromLocal8Bit(d->m_PartialLine));
+    d->m_PartialLine.clear();
+    if (d->m_Output.size() > maximumRetainedOutput)
+        d->m_Output.remove(0, d->m_Output.size() - maximumRetainedOutput);
+
+    return result[QStringLiteral("success")].toBool();
+}
+
+/** Runs several commands through the helper with a single D-Bus call. The helper checks the
+    authorization once and runs some of the commands at the same time.
+    @param commands the commands to run, each one receives its exit code and output
+    @return true if every command could be run
+*/
+bool ExternalCommand::runAll(const QList<ExternalCommand*>& commands)
+{
+    if (commands.isEmpty())
+        return true;
+
+    QVariantList requests;
+    for (const auto& c : commands) {
+        QVariantMap request;
+        request[QStringLiteral("command")] = c->command().isEmpty() ? QString() : c->prepare();
+        request[QStringLiteral("arguments")] = c->args();
+        request[QStringLiteral("input")] = c->d->m_Input;
+        request[QStringLiteral("processChannelMode")] = static_cast<int>(c->d->processChannelMode);
+        requests.append(request);
+    }
+
+    if (!HelperSession::self()->isConnected())
+        return false;
+
+    const QList<QVariantMap> replies = HelperSession::self()->runCommands(requests).get();
+    if (replies.size() != commands.size())
+        return false;
+
+    bool rval = true;
+    for (int i = 0; i < commands.size(); ++i) {
+        commands[i]->d->m_Output = replies[i][QStringLiteral("output")].toByteArray();
+        commands[i]->setExitCode(replies[i].contains(QStringLiteral("exitCode")) ? replies[i][QStringLiteral("exitCode")].toInt() : -1);
+        rval = replies[i][QStringLiteral("success")].toBool() && rval;
+    }
+
+    return rval;
+}
+
+/** Records the command in the report and finds the executable.
+    @return full path of the command
+*/
+QString ExternalCommand::prepare()
+{
     if (report())
         report()->setCommand(xi18nc("@info:status", "Command: %1 %2", command(), args().join(QStringLiteral(" "))));
 
@@ -117,106 +274,203 @@ bool ExternalCommand::start(int timeout)
     if (cmd.isEmpty())
         cmd = QStandardPaths::findExecutable(command(), { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
 
-    auto interface = helperInterface();
-    if (!interface)
-        return false;
+    return cmd;
+}
 
-    bool rval = false;
+/** Reads a request queue limit of a block device from sysfs.
+    @param deviceNode the device node, symlinks such as /dev/mapper/* are resolved
+    @param attribute the name of the attribute in /sys/block/<name>/queue/
+    @return the value or 0 if it is not known
+*/
+static qint64 queueLimit(const QString& deviceNode, const QString& attribute)
+{
+    const QString name = QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+    QFile f(QStringLiteral("/sys/block/%1/queue/%2").arg(name, attribute));
 
-    QDBusPendingCall pcall = interface->RunCommand(cmd, args(), d->m_Input, d->processChannelMode);
+    if (f.open(QIODevice::ReadOnly))
+        return f.readLine().trimmed().toLongLong();
 
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
+    return 0;
+}
 
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
+/** @return the preferred size of a single I/O request for the given device, in bytes */
+static qint64 preferredRequestSize(const Device& device)
+{
+    qint64 size = queueLimit(device.deviceNode(), QStringLiteral("optimal_io_size"));
+    if (size <= 0)
+        size = queueLimit(device.deviceNode(), QStringLiteral("max_sectors_kb")) * 1024;
 
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<QVariantMap> reply = *watcher;
+    return size > 0 ? size : MiB;
+}
+
+bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
+{
+    bool rval = true;
+
+    HelperSession* session = HelperSession::self();
+    if (!session->isConnected())
+        return false;
 
-            d->m_Output = reply.value()[QStringLiteral("output")].toByteArray();
-            setExitCode(reply.value()[QStringLiteral("exitCode")].toInt());
-            rval = reply.value()[QStringLiteral("success")].toBool();
+    // KPMCORE_COPY_QUEUE_DEPTH overrides the number of chunks the helper keeps in flight,
+    // 0 disables the io_uring backend.
+    QVariantMap options;
+    if (qEnvironmentVariableIsSet("KPMCORE_COPY_QUEUE_DEPTH"))
+        options[QStringLiteral("queueDepth")] = qEnvironmentVariableIntValue("KPMCORE_COPY_QUEUE_DEPTH");
+
+    const CopySourceDevice *sourceDevice = dynamic_cast<const CopySourceDevice*>(&source);
+    const CopyTargetDevice *targetDevice = dynamic_cast<const CopyTargetDevice*>(&target);
+
+    // Chunks are multiples of the preferred request size of every device involved, e.g. a full RAID stripe.
+    // The helper starts with the smallest such multiple of at least minimumChunkSize and then tunes the
+    // size from measured throughput, unless KPMCORE_COPY_ADAPTIVE is set to 0.
+    qint64 granularity = 1;
+    if (sourceDevice)
+        granularity = std::lcm(granularity, preferredRequestSize(sourceDevice->device()));
+    if (targetDevice)
+        granularity = std::lcm(granularity, preferredRequestSize(targetDevice->device()));
+    if (granularity <= 1 || granularity > maximumChunkGranularity)
+        granularity = MiB;
+
+    const qint64 blockSize = (minimumChunkSize + granularity - 1) / granularity * granularity; // number of bytes per block to copy
+    options[QStringLiteral("chunkGranularity")] = granularity;
+    options[QStringLiteral("adaptiveChunkSize")] = !qEnvironmentVariableIsSet("KPMCORE_COPY_ADAPTIVE") || qEnvironmentVariableIntValue("KPMCORE_COPY_ADAPTIVE") != 0;
+
+    // Backup images are written as sparse files, unless KPMCORE_COPY_SPARSE is set to 0,
+    // or compressed. Extents the file system does not use are not even read.
+    const CopyTargetFile *targetFile = dynamic_cast<const CopyTargetFile*>(&target);
+    if (targetFile && targetFile->isCompressed()) {
+        options[QStringLiteral("compress")] = true;
+        options[QStringLiteral("fileSystemType")] = targetFile->fileSystemType();
+        if (sourceDevice)
+            options[QStringLiteral("sectorSize")] = sourceDevice->device().logicalSize();
+    } else if (targetFile && (!qEnvironmentVariableIsSet("KPMCORE_COPY_SPARSE") || qEnvironmentVariableIntValue("KPMCORE_COPY_SPARSE") != 0))
+        options[QStringLiteral("sparse")] = true;
+
+    if (options.contains(QStringLiteral("compress")) || options.contains(QStringLiteral("sparse"))) {
+        if (sourceDevice && !sourceDevice->unusedExtents().isEmpty()) {
+            QVariantList extents;
+            for (const auto& extent : sourceDevice->unusedExtents())
+                extents << extent.first << extent.second;
+            options[QStringLiteral("skipExtents")] = extents;
         }
-    };
+    }
+
+    const CopySourceFile *sourceFile = dynamic_cast<const CopySourceFile*>(&source);
+    if (sourceFile && sourceFile->isCompressed())
+        options[QStringLiteral("decompress")] = true;
+
+    // The helper makes shred data itself rather than reading /dev/zero or /dev/urandom.
+    const CopySourceShred *sourceShred = dynamic_cast<const CopySourceShred*>(&source);
+    if (sourceShred)
+        options[QStringLiteral("generate")] = sourceShred->randomShred() ? QStringLiteral("random") : QStringLiteral("zero");
+
+    // Device to device copies bypass the page cache, unless KPMCORE_COPY_DIRECT is set to 0.
+    if (sourceDevice && targetDevice && (!qEnvironmentVariableIsSet("KPMCORE_COPY_DIRECT") || qEnvironmentVariableIntValue("KPMCORE_COPY_DIRECT") != 0)) {
+        options[QStringLiteral("directIO")] = true;
+        options[QStringLiteral("sectorSize")] = qMax(sourceDevice->device().logicalSize(), targetDevice->device().logicalSize());
+    }
+
+    const std::shared_ptr<HelperSignalGuard> guard = forwardHelperSignals();
+
+    QDBusPendingCall pcall = session->call(&OrgKdeKpmcoreExternalcommandInterface::CopyFileData, source.path(), source.firstByte(), source.length(),
+                                           target.path(), target.firstByte(), blockSize, options);
+    pcall.waitForFinished();
+    guard->detach();
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    if (pcall.isError()) {
+        qWarning() << pcall.error();
+        rval = false;
+    } else {
+        QDBusPendingReply<QVariantMap> reply = pcall;
+        rval = reply.value()[QStringLiteral("success")].toBool();
+
+        CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
+        if (byteArrayTarget)
+            byteArrayTarget->m_Array = reply.value()[QStringLiteral("targetByteArray")].toByteArray();
+    }
+    setExitCode(!rval);
 
     return rval;
 }
 
-bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
+/** Fills the target with zeros without copying any data to it, if the device advertises
+    WRITE ZEROES in sysfs. Discarding, even securely, is not used: the device may return
+    anything for discarded blocks afterwards.
+    @param target the range of the device to erase
+    @return true on success, false if the device cannot write zeros by itself or erasing failed
+*/
+bool ExternalCommand::eraseBlocks(const CopyTargetDevice& target)
 {
-    bool rval = true;
-    const qint64 blockSize = 10 * 1024 * 1024; // number of bytes per block to copy
-
-    auto interface = helperInterface();
-    if (!interface)
+    if (queueLimit(target.device().deviceNode(), QStringLiteral("write_zeroes_max_bytes")) <= 0)
         return false;
 
-    connect(interface, &OrgKdeKpmcoreExternalcommandInterface::progress, this, &ExternalCommand::progress);
-    connect(interface, &OrgKdeKpmcoreExternalcommandInterface::report, this, &ExternalCommand::reportSignal);
+    const QStringList methods = { QStringLiteral("zeroOut") };
 
-    QDBusPendingCall pcall = interface->CopyFileData(source.path(), source.firstByte(), source.length(),
-                                                   target.path(), target.firstByte(), blockSize);
-
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
+    HelperSession* session = HelperSession::self();
+    if (!session->isConnected())
+        return false;
 
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<QVariantMap> reply = *watcher;
-            rval = reply.value()[QStringLiteral("success")].toBool();
+    const std::shared_ptr<HelperSignalGuard> guard = forwardHelperSignals();
 
-            CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
-            if (byteArrayTarget)
-                byteArrayTarget->m_Array = reply.value()[QStringLiteral("targetByteArray")].toByteArray();
-        }
-        setExitCode(!rval);
-    };
+    QDBusPendingCall pcall = session->call(&OrgKdeKpmcoreExternalcommandInterface::EraseData, target.path(), target.firstByte(),
+                                           target.lastByte() - target.firstByte() + 1, methods);
+    pcall.waitForFinished();
+    guard->detach();
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    bool rval = false;
+    if (pcall.isError())
+        qWarning() << pcall.error();
+    else {
+        QDBusPendingReply<QVariantMap> reply = pcall;
+        rval = reply.value()[QStringLiteral("success")].toBool();
+    }
+    setExitCode(!rval);
 
     return rval;
 }
 
+/** Emits progress() and reportSignal() for the progress and report signals of the helper,
+    which arrive in the main thread while this command waits for the helper in its own.
+    Receivers in other threads need queued connections to this command.
+    @return the guard to detach once the reply is there
+*/
+std::shared_ptr<HelperSignalGuard> ExternalCommand::forwardHelperSignals()
+{
+    HelperSession* session = HelperSession::self();
+    auto guard = std::make_shared<HelperSignalGuard>(this);
+
+    guard->connections << connect(session, &HelperSession::progress, session, [guard] (int percent) {
+        QMutexLocker locker(&guard->mutex);
+        if (guard->command)
+            Q_EMIT guard->command->progress(percent);
+    }, Qt::DirectConnection);
+
+    guard->connections << connect(session, &HelperSession::report, session, [guard] (const QString& line) {
+        QMutexLocker locker(&guard->mutex);
+        if (guard->command)
+            Q_EMIT guard->command->reportSignal(line);
+    }, Qt::DirectConnection);
+
+    return guard;
+}
+
 QByteArray ExternalCommand::readData(const CopySourceDevice& source)
 {
-    auto interface = helperInterface();
-    if (!interface)
+    if (!HelperSession::self()->isConnected())
         return {};
 
     // Helper is restricted not to resolve symlinks
     QFileInfo sourceInfo(source.path());
-    QDBusPendingCall pcall = interface->ReadData(sourceInfo.canonicalFilePath(), source.firstByte(), source.length());
-
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
+    QDBusPendingReply<QByteArray> reply = HelperSession::self()->call(&OrgKdeKpmcoreExternalcommandInterface::ReadData,
+                                                                      sourceInfo.canonicalFilePath(), source.firstByte(), source.length());
+    reply.waitForFinished();
 
-    QEventLoop loop;
-    QByteArray target;
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
-
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<QByteArray> reply = *watcher;
-
-            target = reply.value();
-        }
-    };
-
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    if (reply.isError()) {
+        qWarning() << reply.error();
+        return {};
+    }
 
-    return target;
+    return reply.value();
 }
 
 bool ExternalCommand::writeData(Report& commandReport, const QByteArray& buffer, const QString& deviceNode, const quint64 firstByte)
@@ -225,56 +479,34 @@ bool ExternalCommand::writeData(Report& commandReport, const QByteArray& buffer,
     if (report())
         report()->setCommand(xi18nc("@info:status", "Command: %1 %2", command(), args().join(QStringLiteral(" "))));
 
-    auto interface = helperInterface();
-    if (!interface)
+    if (!HelperSession::self()->isConnected())
         return false;
 
-    QDBusPendingCall pcall = interface->WriteData(buffer, deviceNode, firstByte);
+    QDBusPendingCall pcall = HelperSession::self()->call(&OrgKdeKpmcoreExternalcommandInterface::WriteData, buffer, deviceNode, firstByte);
     return waitForDbusReply(pcall);
 }
 
 bool ExternalCommand::writeFstab(const QByteArray& fileContents)
 {
-    auto interface = helperInterface();
-    if (!interface)
+    if (!HelperSession::self()->isConnected())
         return false;
 
-    QDBusPendingCall pcall = interface->WriteFstab(fileContents);
+    QDBusPendingCall pcall = HelperSession::self()->call(&OrgKdeKpmcoreExternalcommandInterface::WriteFstab, fileContents);
     return waitForDbusReply(pcall);
 }
 
-OrgKdeKpmcoreExternalcommandInterface* ExternalCommand::helperInterface()
-{
-    if (!QDBusConnection::systemBus().isConnected()) {
-        qWarning() << QDBusConnection::systemBus().lastError().message();
-        return nullptr;
-    }
-
-    auto *interface = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.helperinterface"),
-                QStringLiteral("/Helper"), QDBusConnection::systemBus(), this);
-    interface->setTimeout(10 * 24 * 3600 * 1000); // 10 days
-    return interface;
-}
-
 bool ExternalCommand::waitForDbusReply(QDBusPendingCall &pcall)
 {
     bool rval = true;
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
-
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<bool> reply = *watcher;
-            rval = reply.argumentAt<0>();
-        }
-        setExitCode(!rval);
-    };
+    pcall.waitForFinished();
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    if (pcall.isError())
+        qWarning() << pcall.error();
+    else {
+        QDBusPendingReply<bool> reply = pcall;
+        rval = reply.argumentAt<0>();
+    }
+    setExitCode(!rval);
 
     return rval;
 }
@@ -296,20 +528,59 @@ bool ExternalCommand::run(int timeout)
     return start(timeout) /* && exitStatus() == 0*/;
 }
 
-void ExternalCommand::onReadOutput()
-{
-//     const QByteArray s = readAllStandardOutput();
-//
-//     if(m_Output.length() > 10*1024*1024) { // prevent memory overflow for badly corrupted file systems
-//         if (report())
-//             report()->line() << xi18nc("@info:status", "(Command is printing too much output)");
-//         return;
-//     }
-//
-//     m_Output += s;
-//
-//     if (report())
-//         *report() << QString::fromLocal8Bit(s);
+/** @param parser turns output lines into progress, which is emitted by progress() and
+           passed on to the Report. Lines that carry progress are left out of the Report.
+*/
+void ExternalCommand::setProgressParser(const ProgressParser& parser)
+{
+    d->m_ProgressParser = parser;
+}
+
+/** Splits streamed output into lines. An incomplete last line waits for the next chunk. */
+void ExternalCommand::onReadOutput(const QByteArray& s)
+{
+    // Commands such as e2fsck or pvmove may print for hours. The output is trimmed back to
+    // its end whenever it has grown to twice the limit.
+    d->m_Output += s;
+    if (d->m_Output.size() > 2 * maximumRetainedOutput)
+        d->m_Output.remove(0, d->m_Output.size() - maximumRetainedOutput);
+    d->m_StreamedBytes += s.size();
+    d->m_PartialLine += s;
+
+    int start = 0;
+    for (int i = 0; i < d->m_PartialLine.size(); ++i) {
+        // Progress bars are usually redrawn with a carriage return
+        if (d->m_PartialLine[i] == '\n' || d->m_PartialLine[i] == '\r') {
+            addOutputLine(QString::fromLocal8Bit(d->m_PartialLine.constData() + start, i - start));
+            start = i + 1;
+        }
+    }
+    d->m_PartialLine.remove(0, start);
+}
+
+void ExternalCommand::addOutputLine(const QString& line)
+{
+    if (d->m_ProgressParser) {
+        const int percent = d->m_ProgressParser(line);
+        if (percent >= 0) {
+            Q_EMIT progress(percent);
+            if (report())
+                report()->setProgress(percent);
+            return;
+        }
+    }
+
+    if (!report() || line.isEmpty())
+        return;
+
+    if (d->m_ReportedBytes > maximumReportedOutput)
+        return;
+
+    d->m_ReportedBytes += line.size() + 1;
+    if (d->m_ReportedBytes > maximumReportedOutput)
+        report()->line() << xi18nc("@info:status", "(Command is printing too much output)");
+    else
+        *report() << line + QLatin1Char('\n');
 }
 
 void ExternalCommand::setCommand(const QString& cmd)
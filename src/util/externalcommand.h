@@ -22,6 +22,7 @@
 #include <QThread>
 #include <QVariant>
 
+#include <functional>
 #include <memory>
 
 class KJob;
@@ -29,11 +30,12 @@ class Report;
 class CopySource;
 class CopySourceDevice;
 class CopyTarget;
+class CopyTargetDevice;
 class QDBusInterface;
 class QDBusPendingCall;
-class OrgKdeKpmcoreExternalcommandInterface;
 
 struct ExternalCommandPrivate;
+struct HelperSignalGuard;
 
 /** An external command.
 
@@ -48,6 +50,9 @@ class LIBKPMCORE_EXPORT ExternalCommand : public QObject
     Q_DISABLE_COPY(ExternalCommand)
 
 public:
+    /** Turns a line of output into the progress of the command in percent, -1 if the line is no progress line */
+    typedef std::function<int(const QString&)> ProgressParser;
+
     explicit ExternalCommand(const QString& cmd = QString(), const QStringList& args = QStringList(), const QProcess::ProcessChannelMode processChannelMode = QProcess::MergedChannels);
     explicit ExternalCommand(Report& report, const QString& cmd = QString(), const QStringList& args = QStringList(), const QProcess::ProcessChannelMode processChannelMode = QProcess::MergedChannels);
 
@@ -55,6 +60,7 @@ public:
 
 public:
     bool copyBlocks(const CopySource& source, CopyTarget& target);
+    bool eraseBlocks(const CopyTargetDevice& target);
     QByteArray readData(const CopySourceDevice& source);
     bool writeData(Report& commandReport, const QByteArray& buffer, const QString& deviceNode, const quint64 firstByte); // same as copyBlocks but from QByteArray
     bool writeFstab(const QByteArray& fileContents);
@@ -74,15 +80,19 @@ public:
 
     bool write(const QByteArray& input); /**< @param input the input for the program */
 
+    void setProgressParser(const ProgressParser& parser);
+
     bool start(int timeout = 30000);
     bool run(int timeout = 30000);
 
+    static bool runAll(const QList<ExternalCommand*>& commands);
+
     /**< @return the exit code */
     int exitCode() const;
 
-    /**< @return the command output */
+    /**< @return the command output, only its last 4 MiB if it was streamed to a Report or progress parser */
     const QString output() const;
-    /**< @return the command output */
+    /**< @return the command output, only its last 4 MiB if it was streamed to a Report or progress parser */
     const QByteArray& rawOutput() const;
 
     /**< @return pointer to the Report or nullptr */
@@ -94,9 +104,12 @@ Q_SIGNALS:
 
 private:
     void setExitCode(int i);
-    void onReadOutput();
+    QString prepare();
+    bool stream(const QString& cmd);
+    std::shared_ptr<HelperSignalGuard> forwardHelperSignals();
+    void onReadOutput(const QByteArray& s);
+    void addOutputLine(const QString& line);
     bool waitForDbusReply(QDBusPendingCall &pcall);
-    OrgKdeKpmcoreExternalcommandInterface* helperInterface();
 
 private:
     std::unique_ptr<ExternalCommandPrivate> d;
@@ -12,10 +12,26 @@
 
 #include "externalcommandhelper.h"
 #include "externalcommand_whitelist.h"
+#include "chunksizecontroller.h"
+#include "copypipeline.h"
+#ifdef HAVE_LIBURING
+#include "uringcopy.h"
+#endif
+#ifdef HAVE_ZSTD
+#include "zstdframes.h"
+#endif
+#include "chacha20.h"
+#include "compressedbackup.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 
 #include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 #include <QtDBus>
 
@@ -25,7 +41,10 @@
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QLocale>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
 #include <QVariant>
 
 #include <KLocalizedString>
@@ -76,6 +95,19 @@ ExternalCommandHelper::ExternalCommandHelper()
     @return true on success
 */
 bool ExternalCommandHelper::readData(QFile& device, QByteArray& buffer, const qint64 offset, const qint64 size)
+{
+    buffer.resize(size);
+    return readData(device, buffer.data(), offset, size);
+}
+
+/** Reads the given number of bytes from the sourceDevice into memory that the caller owns.
+    @param sourceDevice device or file to read from
+    @param buffer memory of at least size bytes to store the bytes read in
+    @param offset offset where to begin reading
+    @param size the number of bytes to read
+    @return true on success
+*/
+bool ExternalCommandHelper::readData(QFile& device, char* buffer, const qint64 offset, const qint64 size)
 {
     if (!device.isOpen()) {
         if (!device.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
@@ -90,9 +122,7 @@ bool ExternalCommandHelper::readData(QFile& device, QByteArray& buffer, const qi
         return false;
     }
 
-    buffer = device.read(size);
-
-    if (size != buffer.size()) {
+    if (device.read(buffer, size) != size) {
         qCritical() << xi18n("Could not read from device <filename>%1</filename>.", device.fileName());
         return false;
     }
@@ -107,6 +137,18 @@ bool ExternalCommandHelper::readData(QFile& device, QByteArray& buffer, const qi
     @return true on success
 */
 bool ExternalCommandHelper::writeData(QFile& device, const QByteArray& buffer, const qint64 offset)
+{
+    return writeData(device, buffer.constData(), offset, buffer.size());
+}
+
+/** Writes size bytes from buffer to a given device.
+    @param device device or file to write to
+    @param buffer the data that we write
+    @param offset offset where to begin writing
+    @param size the number of bytes to write
+    @return true on success
+*/
+bool ExternalCommandHelper::writeData(QFile& device, const char* buffer, const qint64 offset, const qint64 size)
 {
     auto flags = QIODevice::WriteOnly | QIODevice::Unbuffered;
     if (!device.isOpen()) {
@@ -121,7 +163,7 @@ bool ExternalCommandHelper::writeData(QFile& device, const QByteArray& buffer, c
         return false;
     }
 
-    if (device.write(buffer) != buffer.size()) {
+    if (device.write(buffer, size) != size) {
         qCritical() << xi18n("Could not write to device <filename>%1</filename>.", device.fileName());
         return false;
     }
@@ -129,6 +171,81 @@ bool ExternalCommandHelper::writeData(QFile& device, const QByteArray& buffer, c
     return true;
 }
 
+/** Reads size bytes like readData, but fills the parts inside skipExtents with zeros instead of reading them.
+    @param device device or file to read from
+    @param buffer memory of at least size bytes to store the bytes read in
+    @param offset offset where to begin reading
+    @param size the number of bytes to read
+    @param skipExtents absolute (offset, length) pairs, sorted by offset
+    @return true on success
+*/
+bool ExternalCommandHelper::readDataSkipping(QFile& device, char* buffer, const qint64 offset, const qint64 size, const std::vector<std::pair<qint64, qint64>>& skipExtents)
+{
+    // First extent that ends after offset
+    auto extent = std::upper_bound(skipExtents.begin(), skipExtents.end(), offset, [] (qint64 value, const std::pair<qint64, qint64>& e) {
+        return value < e.first + e.second;
+    });
+
+    qint64 pos = offset;
+    const qint64 end = offset + size;
+    while (pos < end) {
+        if (extent != skipExtents.end() && extent->first <= pos) {
+            const qint64 skipEnd = qMin(end, extent->first + extent->second);
+            memset(buffer + (pos - offset), 0, skipEnd - pos);
+            pos = skipEnd;
+            ++extent;
+            continue;
+        }
+
+        const qint64 readEnd = extent != skipExtents.end() ? qMin(end, extent->first) : end;
+        if (!readData(device, buffer + (pos - offset), pos, readEnd - pos))
+            return false;
+        pos = readEnd;
+    }
+
+    return true;
+}
+
+/** Writes size bytes like writeData, but leaves holes instead of writing runs of zeros.
+    @param device regular file to write to
+    @param buffer the data that we write
+    @param offset offset where to begin writing
+    @param size the number of bytes to write
+    @param bytesSkipped incremented by the number of bytes that were not written
+    @return true on success
+*/
+bool ExternalCommandHelper::writeSparseData(QFile& device, const char* buffer, const qint64 offset, const qint64 size, qint64& bytesSkipped)
+{
+    if (!device.isOpen() && !device.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for writing.", device.fileName());
+        return false;
+    }
+
+    auto writeRun = [&] (qint64 start, qint64 end, bool zero) {
+        // Punching a hole also works if the range already contains data. If the file system cannot
+        // do it, the zeros are written after all.
+        if (zero && fallocate(device.handle(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset + start, end - start) == 0) {
+            bytesSkipped += end - start;
+            return true;
+        }
+        return writeData(device, buffer + start, offset + start, end - start);
+    };
+
+    qint64 runStart = 0;
+    bool runIsZero = false;
+    for (qint64 pos = 0; pos < size; pos += sparseBlockSize) {
+        const bool zero = isAllZero(buffer + pos, qMin(sparseBlockSize, size - pos));
+        if (pos > 0 && zero != runIsZero) {
+            if (!writeRun(runStart, pos, runIsZero))
+                return false;
+            runStart = pos;
+        }
+        runIsZero = zero;
+    }
+
+    return writeRun(runStart, size, runIsZero);
+}
+
 /** Creates a new fstab file with given contents.
     @param Contents the data that we write
     @return true on success
@@ -160,8 +277,51 @@ bool ExternalCommandHelper::WriteFstab(const QByteArray& fstabContents)
     return true;
 }
 
-// If targetDevice is empty then return QByteArray with data that was read from disk.
-QVariantMap ExternalCommandHelper::CopyFileData(const QString& sourceDevice, const qint64 sourceOffset, const qint64 sourceLength, const QString& targetDevice, const qint64 targetOffset, const qint64 chunkSize)
+/** Opens file with O_DIRECT, bypassing the page cache.
+    @param file the file to open, its file name must be set
+    @param mode QIODevice::ReadOnly or QIODevice::WriteOnly
+    @return true on success
+*/
+static bool openDirect(QFile& file, QIODevice::OpenMode mode)
+{
+    const int flags = (mode & QIODevice::WriteOnly ? O_WRONLY : O_RDONLY) | O_DIRECT | O_CLOEXEC;
+    const int fd = open(file.fileName().toLocal8Bit().constData(), flags);
+    if (fd < 0)
+        return false;
+
+    if (!file.open(fd, mode | QIODevice::Unbuffered, QFileDevice::AutoCloseHandle)) {
+        close(fd);
+        return false;
+    }
+
+    return true;
+}
+
+/** Copies sourceLength bytes from sourceDevice to targetDevice.
+
+    Supported options:
+    - queueDepth: number of chunks the io_uring backend keeps in flight,
+      0 disables io_uring and uses the pipelined QFile path.
+    - directIO: bypass the page cache with O_DIRECT if offsets allow it.
+    - sectorSize: logical sector size used to check O_DIRECT alignment, also recorded
+      in the header of compressed backups.
+    - adaptiveChunkSize: start with chunkSize and tune it from measured throughput.
+    - chunkGranularity: adaptive chunk sizes are multiples of this, defaults to chunkSize.
+    - sparse: if the target is a regular file, leave holes instead of writing zeros.
+    - skipExtents: (offset, length) pairs relative to sourceOffset that are not read
+      and end up as holes, only used together with sparse or compress.
+    - compress: write the target as a compressed backup, see compressedbackup.h.
+      targetOffset has to be 0.
+    - compressionLevel: zstd compression level, defaults to defaultCompressionLevel.
+    - fileSystemType: recorded in the header of compressed backups.
+    - decompress: the source is a compressed backup, sourceOffset has to be 0 and
+      sourceLength has to match the length recorded in its header.
+    - generate: "zero" or "random" to write generated data instead of reading the source,
+      random data comes from ChaCha20Stream.
+
+    If io_uring is not available the pipelined QFile path is used.
+*/
+QVariantMap ExternalCommandHelper::CopyFileData(const QString& sourceDevice, const qint64 sourceOffset, const qint64 sourceLength, const QString& targetDevice, const qint64 targetOffset, const qint64 chunkSize, const QVariantMap& options)
 {
     if (!isCallerAuthorized()) {
         return {};
@@ -173,7 +333,7 @@ QVariantMap ExternalCommandHelper::CopyFileData(const QString& sourceDevice, con
     }
 
     // Prevent some out of memory situations
-    if (chunkSize > 100 * MiB) {
+    if (chunkSize > maxChunkSize) {
         return {};
     }
 
@@ -207,88 +367,480 @@ QVariantMap ExternalCommandHelper::CopyFileData(const QString& sourceDevice, con
     };
     qint8 copyDirection = targetOffset > sourceOffset ? CopyDirection::Right : CopyDirection::Left;
 
-    // Let readOffset (r) and writeOffset (w) be the offsets of the first chunk that we move.
-    // When we move data to the left:
-    // ______target______         ______source______
-    // r                     <-   w=================
-    qint64 readOffset = sourceOffset;
-    qint64 writeOffset = targetOffset;
+    // Compressed data is read or written sequentially. Source and target are different files
+    // then, so the direction does not matter.
+    const bool compress = options.value(QStringLiteral("compress")).toBool();
+    const bool decompress = options.value(QStringLiteral("decompress")).toBool();
+    if (compress || decompress) {
+#ifndef HAVE_ZSTD
+        Q_EMIT report(xi18nc("@info:progress", "Compressed backups are not supported, the helper was built without zstd."));
+        reply[QStringLiteral("success")] = false;
+        return reply;
+#endif
+        if (compress == decompress || (compress && targetOffset != 0) || (decompress && sourceOffset != 0))
+            return {};
+        copyDirection = CopyDirection::Left;
+    }
+
+    // Frames of a compressed source and where each of them starts in the file
+    std::vector<CompressedBackup::Frame> frames;
+    std::vector<qint64> frameOffsets;
+    qint64 largestFrame = 0;
+    if (decompress) {
+        QFile backup(sourceDevice);
+        CompressedBackup::Header header;
+        bool valid = backup.open(QIODevice::ReadOnly) && CompressedBackup::parseHeader(backup.read(CompressedBackup::headerFrameSize), header)
+                && header.sourceLength == sourceLength && CompressedBackup::readSeekTable(backup, frames);
+
+        qint64 offset = CompressedBackup::headerFrameSize;
+        qint64 length = 0;
+        for (const auto& frame : frames) {
+            valid = valid && frame.decompressedSize > 0 && frame.decompressedSize <= maxChunkSize;
+            frameOffsets.push_back(offset);
+            offset += frame.compressedSize;
+            length += frame.decompressedSize;
+            largestFrame = qMax<qint64>(largestFrame, frame.decompressedSize);
+        }
+
+        if (!valid || length != sourceLength || offset > backup.size()) {
+            Q_EMIT report(xi18nc("@info:progress", "<filename>%1</filename> is not a valid compressed backup.", sourceDevice));
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+    }
 
-    // When we move data to the right, we start moving data from the last chunk
+    // Chunks may change their size during the copy, but they always follow each other without gaps.
+    // When we move data to the left, the first chunk starts at the beginning of the source
+    // and every following chunk starts where the previous one ended:
+    // ______target______         ______source______
+    // w=====                <-   r=====
+    // When we move data to the right, the first chunk ends at the end of the source
+    // and every following chunk ends where the previous one started:
     // ______source______         ______target______
-    // =================r    ->                    w
-    if (copyDirection == CopyDirection::Right) {
-        readOffset = sourceOffset + sourceLength - chunkSize;
-        writeOffset = targetOffset + sourceLength - chunkSize;
+    //            =====r     ->              =====w
+    // Either way a chunk is only written after all chunks before it were read, and its
+    // target range can only overlap the source ranges of those earlier chunks.
+    const int queueDepth = qBound(0, options.value(QStringLiteral("queueDepth"), defaultQueueDepth).toInt(), maxQueueDepth);
+    // When decompressing, every chunk is one of the frames in the backup.
+    const bool adaptive = options.value(QStringLiteral("adaptiveChunkSize")).toBool() && !decompress;
+    const qint64 granularity = qBound<qint64>(1, options.value(QStringLiteral("chunkGranularity"), chunkSize).toLongLong(), chunkSize);
+
+    // Adaptive chunks may grow up to what the buffers of the copy engine allow.
+    qint64 bufferSize = decompress ? qMax<qint64>(largestFrame, 1) : chunkSize;
+    if (adaptive) {
+        bufferSize = qBound(chunkSize, copyRingMemory / qMax(queueDepth, 4), maxChunkSize);
+        bufferSize -= bufferSize % granularity;
+    }
+    ChunkSizeController chunkSizeController(chunkSize, granularity, bufferSize, adaptive);
+
+    // O_DIRECT keeps multi-terabyte copies from evicting everything else from the page cache.
+    // It needs sector aligned offsets and sizes. When moving right, chunk offsets are counted
+    // from the end of the source, so then the source length has to be aligned as well.
+    const qint64 sectorSize = qMax<qint64>(options.value(QStringLiteral("sectorSize")).toLongLong(), 512);
+    const bool alignedForDirectIO = sourceOffset % sectorSize == 0 && targetOffset % sectorSize == 0
+            && chunkSize % sectorSize == 0 && granularity % sectorSize == 0
+            && (copyDirection == CopyDirection::Left || sourceLength % sectorSize == 0);
+
+    QFile target(targetDevice);
+    QFile source(sourceDevice);
+    QFile directTarget(targetDevice);
+    QFile directSource(sourceDevice);
+
+    bool directIO = false;
+    if (options.value(QStringLiteral("directIO")).toBool()) {
+        directIO = alignedForDirectIO && openDirect(directSource, QIODevice::ReadOnly) && openDirect(directTarget, QIODevice::WriteOnly);
+        if (!directIO)
+            Q_EMIT report(xi18nc("@info:progress", "Direct I/O is not possible for this copy, using buffered I/O."));
+    }
+
+    QFile& chunkSource = directIO ? directSource : source;
+    QFile& chunkTarget = directIO ? directTarget : target;
+
+    // Sparse copies only make sense for files, a hole in a block device is not a thing.
+    // Compressed backups have no runs of zeros worth skipping.
+    const bool sparse = options.value(QStringLiteral("sparse")).toBool() && !compress && std::filesystem::is_regular_file(targetPath);
+    std::vector<std::pair<qint64, qint64>> skipExtents;
+    if (sparse || compress) {
+        const QVariantList extents = options.value(QStringLiteral("skipExtents")).toList();
+        for (int i = 0; i + 1 < extents.size(); i += 2)
+            skipExtents.emplace_back(sourceOffset + extents[i].toLongLong(), extents[i + 1].toLongLong());
     }
+    qint64 bytesSkipped = 0;
+
+    // Shredding does not need to read /dev/zero or /dev/urandom, the data is made in the buffers.
+    const QString generate = options.value(QStringLiteral("generate")).toString();
+    std::unique_ptr<ChaCha20Stream> randomStream;
+    if (generate == QStringLiteral("random")) {
+        randomStream = std::make_unique<ChaCha20Stream>();
+        if (!randomStream->isValid()) {
+            Q_EMIT report(xi18nc("@info:progress", "Could not seed the random number generator."));
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+    }
+    const bool generateZeros = generate == QStringLiteral("zero");
+
+#ifdef HAVE_ZSTD
+    // zstd splits every chunk into jobs for its worker threads, while the next chunk is being read.
+    std::unique_ptr<ZstdFrameCompressor> compressor;
+    std::unique_ptr<ZstdFrameDecompressor> decompressor;
+    if (compress)
+        compressor = std::make_unique<ZstdFrameCompressor>(options.value(QStringLiteral("compressionLevel"), defaultCompressionLevel).toInt(), QThread::idealThreadCount());
+    if (decompress)
+        decompressor = std::make_unique<ZstdFrameDecompressor>();
+    if ((compressor && !compressor->isValid()) || (decompressor && !decompressor->isValid())) {
+        Q_EMIT report(xi18nc("@info:progress", "Could not initialize zstd."));
+        reply[QStringLiteral("success")] = false;
+        return reply;
+    }
+#endif
+    // Frames written to a compressed target so far and where the next one goes
+    std::vector<CompressedBackup::Frame> writtenFrames;
+    qint64 compressedEnd = CompressedBackup::headerFrameSize;
 
-    const qint64 chunksToCopy = sourceLength / chunkSize;
-    const qint64 lastBlock = sourceLength % chunkSize;
+    // An unaligned tail cannot go through O_DIRECT, it is copied through the page cache
+    // after all other chunks. That is the same position it has in the chunk order anyway.
+    const qint64 tailLength = directIO ? sourceLength % sectorSize : 0;
+    const qint64 chunkedLength = sourceLength - tailLength;
 
     qint64 bytesWritten = 0;
     qint64 chunksCopied = 0;
 
-    QByteArray buffer;
     int percent = 0;
     QElapsedTimer timer;
 
     timer.start();
 
-    QString reportText = xi18nc("@info:progress", "Copying %1 chunks (%2 bytes) from %3 to %4, direction: %5.", chunksToCopy,
-                                              sourceLength, readOffset, writeOffset, copyDirection == CopyDirection::Left ? i18nc("direction: left", "left")
-                                              : i18nc("direction: right", "right"));
+    QString reportText = xi18nc("@info:progress", "Copying %1 bytes from %2 to %3 in chunks of %4 bytes, direction: %5.", sourceLength,
+                                sourceOffset, targetOffset, chunkSizeController.size(), copyDirection == CopyDirection::Left ? i18nc("direction: left", "left")
+                                : i18nc("direction: right", "right"));
     Q_EMIT report(reportText);
 
-    bool rval = true;
+    // Called by the reader stage only.
+    qint64 bytesScheduled = 0;
+    size_t framesScheduled = 0;
+    auto nextChunk = [&] (CopyChunk& chunk) {
+        if (decompress) {
+            if (framesScheduled >= frames.size())
+                return false;
+
+            chunk = { frameOffsets[framesScheduled], targetOffset + bytesScheduled, frames[framesScheduled].decompressedSize };
+            bytesScheduled += chunk.size;
+            ++framesScheduled;
+            return true;
+        }
 
-    QFile target(targetDevice);
-    QFile source(sourceDevice);
-    while (chunksCopied < chunksToCopy) {
-        if (!(rval = readData(source, buffer, readOffset + chunkSize * chunksCopied * copyDirection, chunkSize)))
-            break;
+        if (bytesScheduled >= chunkedLength)
+            return false;
 
-        if (!(rval = writeData(target, buffer, writeOffset + chunkSize * chunksCopied * copyDirection)))
-            break;
+        const qint64 size = qMin(chunkSizeController.size(), chunkedLength - bytesScheduled);
+        if (copyDirection == CopyDirection::Left)
+            chunk = { sourceOffset + bytesScheduled, targetOffset + bytesScheduled, size };
+        else
+            chunk = { sourceOffset + sourceLength - bytesScheduled - size, targetOffset + sourceLength - bytesScheduled - size, size };
 
-        bytesWritten += buffer.size();
+        bytesScheduled += size;
+        return true;
+    };
 
-        if (++chunksCopied * 100 / chunksToCopy != percent) {
-            percent = chunksCopied * 100 / chunksToCopy;
+    QByteArray compressedInput;
+    QByteArray compressedOutput;
+    auto readChunk = [&] (char* buffer, const CopyChunk& chunk) {
+        if (randomStream) {
+            randomStream->fill(buffer, chunk.size);
+            return true;
+        }
+        if (generateZeros) {
+            memset(buffer, 0, chunk.size);
+            return true;
+        }
+#ifdef HAVE_ZSTD
+        if (decompress) {
+            const auto& frame = frames[std::lower_bound(frameOffsets.begin(), frameOffsets.end(), chunk.readOffset) - frameOffsets.begin()];
+            return readData(chunkSource, compressedInput, chunk.readOffset, frame.compressedSize) && decompressor->decompress(compressedInput, frame, buffer);
+        }
+#endif
+        if (!skipExtents.empty())
+            return readDataSkipping(chunkSource, buffer, chunk.readOffset, chunk.size, skipExtents);
+        return readData(chunkSource, buffer, chunk.readOffset, chunk.size);
+    };
+    auto writeChunk = [&] (const char* buffer, const CopyChunk& chunk) {
+#ifdef HAVE_ZSTD
+        if (compress) {
+            CompressedBackup::Frame frame;
+            if (!compressor->compress(buffer, chunk.size, compressedOutput, frame) || !writeData(chunkTarget, compressedOutput, compressedEnd))
+                return false;
+
+            writtenFrames.push_back(frame);
+            compressedEnd += frame.compressedSize;
+            return true;
+        }
+#endif
+        if (sparse)
+            return writeSparseData(chunkTarget, buffer, chunk.writeOffset, chunk.size, bytesSkipped);
+        return writeData(chunkTarget, buffer, chunk.writeOffset, chunk.size);
+    };
+
+    // Without O_DIRECT, start writeback of every chunk as soon as it is written. Chunks that are
+    // more than copyRingMemory behind are waited for and dropped from the page cache on both sides.
+    // By then their writeback has usually finished, so the completion loop rarely blocks and the
+    // reads and writes in flight are not held up. This bounds dirty memory to about as much as is
+    // in flight instead of flushing everything when the device is closed.
+    // The reader and the writer run in threads of their own and QFile is not thread-safe, so
+    // both ends are opened here and the writeback only uses their file descriptors.
+    if (generate.isEmpty() && !chunkSource.isOpen() && !chunkSource.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for reading.", chunkSource.fileName());
+        reply[QStringLiteral("success")] = false;
+        return reply;
+    }
+    if (!chunkTarget.isOpen() && !chunkTarget.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for writing.", chunkTarget.fileName());
+        reply[QStringLiteral("success")] = false;
+        return reply;
+    }
+    // -1 if the source is not read or cannot be read at an offset, e.g. /dev/zero
+    const int sourceFd = chunkSource.isOpen() && !chunkSource.isSequential() ? chunkSource.handle() : -1;
+    const int targetFd = chunkTarget.handle();
+
+    std::deque<CopyChunk> writeBackChunks;
+    qint64 writeBackBytes = 0;
+    auto dropChunk = [&] (const CopyChunk& chunk, int flags) {
+        if (flags)
+            sync_file_range(targetFd, chunk.writeOffset, chunk.size, flags);
+        posix_fadvise(targetFd, chunk.writeOffset, chunk.size, POSIX_FADV_DONTNEED);
+        if (sourceFd >= 0)
+            posix_fadvise(sourceFd, chunk.readOffset, chunk.size, POSIX_FADV_DONTNEED);
+    };
+    auto writeBack = [&] (const CopyChunk& chunk) {
+        sync_file_range(targetFd, chunk.writeOffset, chunk.size, SYNC_FILE_RANGE_WRITE);
+        writeBackChunks.push_back(chunk);
+        writeBackBytes += chunk.size;
+
+        while (writeBackBytes > copyRingMemory) {
+            const CopyChunk lagging = writeBackChunks.front();
+            writeBackChunks.pop_front();
+            writeBackBytes -= lagging.size;
+            dropChunk(lagging, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        }
+    };
+
+    auto chunkFinished = [&] (const CopyChunk& chunk) {
+        bytesWritten += chunk.size;
+        ++chunksCopied;
+
+        // The target range of a compressed chunk is the frame that was just appended.
+        if (!directIO && compress)
+            writeBack({ chunk.readOffset, compressedEnd - writtenFrames.back().compressedSize, writtenFrames.back().compressedSize });
+        else if (!directIO)
+            writeBack(chunk);
+
+        if (chunkSizeController.chunkFinished(chunk.size)) {
+            const ChunkSizeController::Phase& phase = chunkSizeController.phases().last();
+            Q_EMIT report(xi18nc("@info:progress", "Chunk size %1: %2 MiB/second.", QLocale().formattedDataSize(phase.chunkSize),
+                                 QString::number(phase.mibPerSecond, 'f', 1)));
+            if (chunkSizeController.isSettled())
+                Q_EMIT report(xi18nc("@info:progress", "Using chunk size %1 for the rest of the copy.", QLocale().formattedDataSize(chunkSizeController.size())));
+        }
+
+        if (bytesWritten * 100 / sourceLength != percent) {
+            percent = bytesWritten * 100 / sourceLength;
 
             if (percent % 5 == 0 && timer.elapsed() > 1000) {
-                const qint64 mibsPerSec = (chunksCopied * chunkSize / 1024 / 1024) / (timer.elapsed() / 1000);
-                const qint64 estSecsLeft = (100 - percent) * timer.elapsed() / percent / 1000;
+                const qint64 mibsPerSec = (bytesWritten / 1024 / 1024) / (timer.elapsed() / 1000);
+                const qint64 estSecsLeft = (100 - percent) * timer.elapsed() / qMax(percent, 1) / 1000;
                 reportText = xi18nc("@info:progress", "Copying %1 MiB/second, estimated time left: %2", mibsPerSec, QTime(0, 0).addSecs(estSecsLeft).toString());
                 Q_EMIT report(reportText);
             }
             Q_EMIT progress(percent);
         }
+    };
+
+    if (compress) {
+        CompressedBackup::Header header;
+        header.sourceLength = sourceLength;
+        header.sectorSize = options.value(QStringLiteral("sectorSize")).toUInt();
+        header.fileSystemType = options.value(QStringLiteral("fileSystemType")).toInt();
+        if (!writeData(target, CompressedBackup::serializeHeader(header), 0)) {
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
     }
 
-    // copy the remainder
-    if (rval && lastBlock > 0) {
-        Q_ASSERT(lastBlock < chunkSize);
+    bool rval = false;
+    QString backend;
+
+#ifdef HAVE_LIBURING
+    // io_uring needs positional I/O, so sequential sources such as /dev/zero keep using the QFile path.
+    // Sparse and compressed copies decide per chunk what to write, they use the QFile path as well,
+    // and so do generated sources that are not read at all.
+    if (queueDepth > 0 && !sparse && !compress && !decompress && generate.isEmpty() && sourceFd >= 0) {
+        UringCopy engine(static_cast<int>(qBound<qint64>(1, copyRingMemory / bufferSize, queueDepth)), bufferSize);
+        if (engine.isValid()) {
+            backend = engine.fixedBuffers() ? xi18nc("@info:progress", "io_uring, queue depth %1, registered buffers", engine.queueDepth())
+                                            : xi18nc("@info:progress", "io_uring, queue depth %1", engine.queueDepth());
+            rval = engine.run(sourceFd, targetFd, nextChunk, chunkFinished);
+        }
+    }
+#endif
 
-        const qint64 lastBlockReadOffset = copyDirection == CopyDirection::Left ? readOffset + chunkSize * chunksCopied : sourceOffset;
-        const qint64 lastBlockWriteOffset = copyDirection == CopyDirection::Left ? writeOffset + chunkSize * chunksCopied : targetOffset;
-        reportText = xi18nc("@info:progress", "Copying remainder of chunk size %1 from %2 to %3.", lastBlock, lastBlockReadOffset, lastBlockWriteOffset);
-        Q_EMIT report(reportText);
-        rval = readData(source, buffer, lastBlockReadOffset, lastBlock);
+    if (backend.isEmpty()) {
+        CopyPipeline pipeline(static_cast<int>(qBound<qint64>(2, copyRingMemory / bufferSize, 4)), bufferSize);
+        backend = xi18nc("@info:progress", "pipelined read/write, %1 buffers", pipeline.bufferCount());
+        rval = pipeline.run(nextChunk, readChunk, writeChunk, chunkFinished);
+    }
 
-        if (rval) {
-            rval = writeData(target, buffer, lastBlockWriteOffset);
-        }
+    if (compress || decompress)
+        backend = xi18nc("@info:progress copy backend with compression", "%1, zstd", backend);
+    if (randomStream)
+        backend = xi18nc("@info:progress copy backend with generated data", "%1, ChaCha20 random data", backend);
 
+    // The seek table goes last, after it the file has its final size.
+    if (rval && compress) {
+        const QByteArray seekTable = CompressedBackup::serializeSeekTable(writtenFrames);
+        rval = writeData(target, seekTable, compressedEnd) && target.resize(compressedEnd + seekTable.size());
         if (rval) {
-            Q_EMIT progress(100);
-            bytesWritten += buffer.size();
+            reportText = xi18nc("@info:progress", "Compressed %1 to %2 in %3 frames.", QLocale().formattedDataSize(sourceLength),
+                                QLocale().formattedDataSize(compressedEnd + seekTable.size()), static_cast<qint64>(writtenFrames.size()));
+            Q_EMIT report(reportText);
         }
     }
 
+    if (directIO)
+        backend = xi18nc("@info:progress copy backend with direct I/O", "%1, direct I/O", backend);
+
+    if (rval && tailLength > 0) {
+        reportText = xi18nc("@info:progress", "Copying remainder of chunk size %1 from %2 to %3.", tailLength, sourceOffset + chunkedLength, targetOffset + chunkedLength);
+        Q_EMIT report(reportText);
+
+        QByteArray buffer;
+        rval = readData(source, buffer, sourceOffset + chunkedLength, tailLength) && writeData(target, buffer, targetOffset + chunkedLength);
+        if (rval)
+            chunkFinished({ sourceOffset + chunkedLength, targetOffset + chunkedLength, tailLength });
+    }
+
+    // Holes at the end of a sparse file do not extend it, so set the final size explicitly.
+    if (rval && sparse && target.size() < targetOffset + sourceLength)
+        rval = target.resize(targetOffset + sourceLength);
+
+    // Whatever is still dirty is flushed here rather than when the caller closes the device.
+    if (rval) {
+        for (QFile *file : { &target, &directTarget })
+            if (file->isOpen())
+                rval = fdatasync(file->handle()) == 0 && rval;
+    }
+
+    // After the flush the chunks still waiting for writeback are clean and can be dropped, too.
+    for (const CopyChunk& chunk : writeBackChunks)
+        dropChunk(chunk, 0);
+
+    if (rval)
+        Q_EMIT progress(100);
+
     reportText = xi18ncp("@info:progress argument 2 is a string such as 7 bytes (localized accordingly)", "Copying 1 chunk (%2) finished.", "Copying %1 chunks (%2) finished.", chunksCopied, i18np("1 byte", "%1 bytes", bytesWritten));
     Q_EMIT report(reportText);
 
+    if (sparse) {
+        reportText = xi18nc("@info:progress", "Sparse copy: %1 of %2 were left as holes.", QLocale().formattedDataSize(bytesSkipped), QLocale().formattedDataSize(bytesWritten));
+        Q_EMIT report(reportText);
+    }
+
+    const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    reportText = xi18nc("@info:progress", "Copied %1 MiB in %2 seconds (%3 MiB/second) using %4.", bytesWritten / MiB,
+                        QString::number(elapsed / 1000.0, 'f', 1), QString::number(bytesWritten * 1000.0 / MiB / elapsed, 'f', 1), backend);
+    Q_EMIT report(reportText);
+
     reply[QStringLiteral("success")] = rval;
+    reply[QStringLiteral("chunkSize")] = chunkSizeController.size();
+    return reply;
+}
+
+/** Erases length bytes of a block device without transferring any data.
+
+    Supported methods, tried in the given order until one is accepted by the device:
+    - secureDiscard: BLKSECDISCARD, the device discards the blocks and erases all copies of them.
+      What the blocks read back as afterwards is up to the device, it need not be zeros.
+    - zeroOut: BLKZEROOUT, the device writes zeros, usually without data transfer if it supports WRITE ZEROES.
+
+    Plain BLKDISCARD is not offered, reading discarded blocks may still return the old data.
+    A method that fails on the first request is treated as unsupported, later failures abort.
+
+    @param targetDevice the block device to erase
+    @param targetOffset offset of the first byte to erase, a multiple of the logical sector size
+    @param length number of bytes to erase, a multiple of the logical sector size
+    @param methods the methods to try
+    @return "success" and the "method" that was used
+*/
+QVariantMap ExternalCommandHelper::EraseData(const QString& targetDevice, const qint64 targetOffset, const qint64 length, const QStringList& methods)
+{
+    if (!isCallerAuthorized()) {
+        return {};
+    }
+
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = false;
+
+    // Same restrictions as WriteData
+    if (targetDevice.left(5) != QStringLiteral("/dev/") || !std::filesystem::is_block_file(targetDevice.toStdU16String()))
+        return reply;
+
+    if (targetOffset < 0 || length <= 0)
+        return reply;
+
+    auto canonicalTargetPath = std::filesystem::canonical(std::filesystem::path(targetDevice.toStdU16String()));
+    QFile device(QLatin1String(canonicalTargetPath.c_str()));
+    if (!device.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for writing.", device.fileName());
+        return reply;
+    }
+
+    const std::pair<QString, unsigned long> requests[] = {
+        { QStringLiteral("secureDiscard"), BLKSECDISCARD },
+        { QStringLiteral("zeroOut"), BLKZEROOUT },
+    };
+
+    for (const QString& method : methods) {
+        const auto request = std::find_if(std::begin(requests), std::end(requests), [&method] (const auto& r) { return r.first == method; });
+        if (request == std::end(requests))
+            continue;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        bool rval = true;
+        int percent = 0;
+        for (qint64 erased = 0; erased < length && rval; ) {
+            uint64_t range[2] = { static_cast<uint64_t>(targetOffset + erased), static_cast<uint64_t>(qMin(eraseChunkSize, length - erased)) };
+            if (ioctl(device.handle(), request->second, range) != 0) {
+                if (erased == 0) {
+                    Q_EMIT report(xi18nc("@info:progress", "The device does not support erasing with %1.", method));
+                    break;
+                }
+
+                Q_EMIT report(xi18nc("@info:progress", "Erasing <filename>%1</filename> failed at offset %2: %3", targetDevice, range[0], QString::fromLocal8Bit(strerror(errno))));
+                rval = false;
+                break;
+            }
+
+            erased += range[1];
+            if (erased * 100 / length != percent) {
+                percent = erased * 100 / length;
+                Q_EMIT progress(percent);
+            }
+
+            if (erased == length) {
+                const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+                Q_EMIT report(xi18nc("@info:progress", "Erased %1 in %2 seconds (%3 MiB/second) using %4.", QLocale().formattedDataSize(length),
+                                     QString::number(elapsed / 1000.0, 'f', 1), QString::number(length * 1000.0 / MiB / elapsed, 'f', 1), method));
+                reply[QStringLiteral("success")] = fdatasync(device.handle()) == 0;
+                reply[QStringLiteral("method")] = method;
+                return reply;
+            }
+        }
+
+        if (!rval)
+            return reply;
+    }
+
     return reply;
 }
 
@@ -365,11 +917,69 @@ QVariantMap ExternalCommandHelper::RunCommand(const QString& command, const QStr
     QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
 #endif
 
-    QVariantMap reply;
-    reply[QStringLiteral("success")] = false;
+    if (!isCommandAllowed(command)) {
+        QVariantMap reply;
+        reply[QStringLiteral("success")] = false;
+        return reply;
+    }
+
+    return runCommand(command, arguments, input, processChannelMode);
+}
+
+/** Runs several commands with a single authorization check. Up to maxConcurrentCommands of
+    them run at the same time, every command is subject to the same rules as in RunCommand.
+    @param commands maps with the command, arguments, input and processChannelMode of each command
+    @return maps with success, exitCode and output of each command, in the same order
+*/
+QVariantList ExternalCommandHelper::RunCommands(const QVariantList& commands)
+{
+    if (!isCallerAuthorized()) {
+        return {};
+    }
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
+#endif
+
+    std::vector<QVariantMap> replies(commands.size());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxConcurrentCommands);
+    for (int i = 0; i < commands.size(); ++i) {
+        // Maps nested in a D-Bus variant arrive as QDBusArgument
+        const QVariantMap request = qdbus_cast<QVariantMap>(commands[i]);
+        const QString command = request[QStringLiteral("command")].toString();
+        const QStringList arguments = qdbus_cast<QStringList>(request[QStringLiteral("arguments")]);
+        const QByteArray input = request[QStringLiteral("input")].toByteArray();
+        const int processChannelMode = request[QStringLiteral("processChannelMode")].toInt();
+
+        replies[i][QStringLiteral("success")] = false;
+        if (!isCommandAllowed(command))
+            continue;
+
+        QVariantMap* reply = &replies[i];
+        pool.start(QRunnable::create([this, reply, command, arguments, input, processChannelMode] {
+            *reply = runCommand(command, arguments, input, processChannelMode);
+        }));
+    }
+    pool.waitForDone();
+
+    QVariantList result;
+    result.reserve(commands.size());
+    for (const auto& reply : replies)
+        result.append(reply);
 
+    return result;
+}
+
+/** Checks a command against the whitelist and the trusted prefixes.
+    @param command full path of the command
+    @return true if the helper may run it
+*/
+bool ExternalCommandHelper::isCommandAllowed(const QString& command) const
+{
     if (command.isEmpty()) {
-        return reply;
+        return false;
     }
 
     // Compare with command whitelist
@@ -377,8 +987,7 @@ QVariantMap ExternalCommandHelper::RunCommand(const QString& command, const QStr
     QString basename = fileInfo.fileName();
     if (allowedCommands.find(basename) == allowedCommands.end()) { // TODO: C++20: replace with contains
         qInfo() << command << "command is not one of the whitelisted commands";
-        reply[QStringLiteral("success")] = false;
-        return reply;
+        return false;
     }
 
     // Make sure command is located in the trusted prefix
@@ -389,11 +998,19 @@ QVariantMap ExternalCommandHelper::RunCommand(const QString& command, const QStr
     }
     if (trustedPrefixes.find(prefix.path()) == trustedPrefixes.end()) { // TODO: C++20: replace with contains
         qInfo() << prefix.path() << "prefix is not one of the trusted command prefixes";
-        reply[QStringLiteral("success")] = false;
-        return reply;
+        return false;
     }
 
-//  connect(&cmd, &QProcess::readyReadStandardOutput, this, &ExternalCommandHelper::onReadOutput);
+    return true;
+}
+
+/** Runs a command that passed isCommandAllowed() and waits for it to finish.
+    May be called from several threads at once.
+*/
+QVariantMap ExternalCommandHelper::runCommand(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode) const
+{
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = false;
 
     QProcess cmd;
     cmd.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
@@ -414,20 +1031,96 @@ QVariantMap ExternalCommandHelper::RunCommand(const QString& command, const QStr
     return reply;
 }
 
-void ExternalCommandHelper::onReadOutput()
+/** Runs a command like RunCommand, but sends its output to the client while it runs.
+
+    The output goes out as commandOutput signals addressed to the caller only. They are not
+    broadcast, since other users on the system bus must not see what the helper runs.
+
+    @param streamId identifies the command in the commandOutput signals, chosen by the client
+    @return map with success and exitCode, output holds the last maxRetainedOutput bytes only,
+            outputTruncated tells whether anything was left out and outputSize is the size
+            of all output sent with commandOutput
+*/
+QVariantMap ExternalCommandHelper::StreamCommand(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode, const QString& streamId)
 {
-/*    const QByteArray s = cmd.readAllStandardOutput();
+    if (!isCallerAuthorized()) {
+        return {};
+    }
 
-      if(output.length() > 10*1024*1024) { // prevent memory overflow for badly corrupted file systems
-        if (report())
-            report()->line() << xi18nc("@info:status", "(Command is printing too much output)");
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
+#endif
+
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = false;
+
+    if (!isCommandAllowed(command)) {
+        return reply;
+    }
+    if((processChannelMode != QProcess::SeparateChannels) && (processChannelMode != QProcess::MergedChannels)) {
+        return reply;
+    }
+
+    const QString caller = message().service();
+
+    QProcess cmd;
+    cmd.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
+    cmd.setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannelMode));
+    cmd.start(command, arguments);
+    cmd.write(input);
+    cmd.closeWriteChannel();
+
+    // Output is kept as a ring that is trimmed back to maxRetainedOutput whenever it has
+    // grown to twice that, so tools that run for hours cannot exhaust memory.
+    QByteArray pending;
+    QByteArray retained;
+    qint64 outputSize = 0;
+    bool truncated = false;
+    QElapsedTimer sinceFlush;
+    sinceFlush.start();
+
+    auto flush = [&] () {
+        if (pending.isEmpty())
             return;
-     }
 
-     output += s;
+        QDBusMessage signal = QDBusMessage::createTargetedSignal(caller, QStringLiteral("/Helper"),
+                QStringLiteral("org.kde.kpmcore.externalcommand"), QStringLiteral("commandOutput"));
+        signal << streamId << pending;
+        connection().send(signal);
+        outputSize += pending.size();
+
+        retained += pending;
+        if (retained.size() > 2 * maxRetainedOutput) {
+            retained.remove(0, retained.size() - maxRetainedOutput);
+            truncated = true;
+        }
+
+        pending.clear();
+        sinceFlush.restart();
+    };
+
+    while (cmd.state() != QProcess::NotRunning) {
+        cmd.waitForReadyRead(outputFlushInterval);
+        pending += cmd.readAllStandardOutput();
+        if (pending.size() >= outputChunkSize || sinceFlush.elapsed() >= outputFlushInterval)
+            flush();
+    }
 
-     if (report())
-         *report() << QString::fromLocal8Bit(s);*/
+    pending += cmd.readAllStandardOutput();
+    flush();
+
+    if (retained.size() > maxRetainedOutput) {
+        retained.remove(0, retained.size() - maxRetainedOutput);
+        truncated = true;
+    }
+
+    reply[QStringLiteral("output")] = retained;
+    reply[QStringLiteral("outputTruncated")] = truncated;
+    reply[QStringLiteral("outputSize")] = outputSize;
+    reply[QStringLiteral("exitCode")] = cmd.exitCode();
+
+    reply[QStringLiteral("success")] = true;
+    return reply;
 }
 
 bool ExternalCommandHelper::isCallerAuthorized()
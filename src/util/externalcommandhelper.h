@@ -13,6 +13,8 @@
 
 #include <memory>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <QDBusContext>
 #include <QEventLoop>
@@ -22,6 +24,27 @@
 
 class QDBusServiceWatcher;
 constexpr qint64 MiB = 1 << 20;
+// Largest chunk a single read or write of CopyFileData may use
+constexpr qint64 maxChunkSize = 100 * MiB;
+// Upper bound for the memory held by the buffers of a single CopyFileData call
+constexpr qint64 copyRingMemory = 256 * MiB;
+// Number of chunks kept in flight by the io_uring copy backend unless the caller asks otherwise
+constexpr int defaultQueueDepth = 8;
+constexpr int maxQueueDepth = 64;
+// Runs of zeros are detected with this granularity when writing sparse files
+constexpr qint64 sparseBlockSize = 64 * 1024;
+// zstd level for compressed backups unless the caller asks otherwise
+constexpr int defaultCompressionLevel = 3;
+// EraseData issues one discard or zero-out request per this many bytes, to report progress
+constexpr qint64 eraseChunkSize = 1024 * MiB;
+// Number of commands of a single RunCommands call that run at the same time
+constexpr int maxConcurrentCommands = 8;
+// StreamCommand sends output once this much has gathered or this many milliseconds have passed
+constexpr int outputChunkSize = 64 * 1024;
+constexpr int outputFlushInterval = 100;
+// The reply of StreamCommand only keeps the last this many bytes, the client got all output from
+// commandOutput signals, which are only sent to the client that called StreamCommand
+constexpr qint64 maxRetainedOutput = 4 * MiB;
 
 class ExternalCommandHelper : public QObject, public QDBusContext
 {
@@ -35,20 +58,28 @@ Q_SIGNALS:
 public:
     ExternalCommandHelper();
     bool readData(QFile& device, QByteArray& buffer, const qint64 offset, const qint64 size);
+    bool readData(QFile& device, char* buffer, const qint64 offset, const qint64 size);
     bool writeData(QFile& device, const QByteArray& buffer, const qint64 offset);
+    bool writeData(QFile& device, const char* buffer, const qint64 offset, const qint64 size);
+    bool readDataSkipping(QFile& device, char* buffer, const qint64 offset, const qint64 size, const std::vector<std::pair<qint64, qint64>>& skipExtents);
+    bool writeSparseData(QFile& device, const char* buffer, const qint64 offset, const qint64 size, qint64& bytesSkipped);
 
 public Q_SLOTS:
     Q_SCRIPTABLE QVariantMap RunCommand(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode);
+    Q_SCRIPTABLE QVariantList RunCommands(const QVariantList& commands);
+    Q_SCRIPTABLE QVariantMap StreamCommand(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode, const QString& streamId);
     Q_SCRIPTABLE QVariantMap CopyFileData(const QString& sourceDevice, const qint64 sourceOffset, const qint64 sourceLength,
-                                        const QString& targetDevice, const qint64 targetOffset, const qint64 blockSize);
+                                        const QString& targetDevice, const qint64 targetOffset, const qint64 blockSize, const QVariantMap& options);
+    Q_SCRIPTABLE QVariantMap EraseData(const QString& targetDevice, const qint64 targetOffset, const qint64 length, const QStringList& methods);
     Q_SCRIPTABLE QByteArray ReadData(const QString& device, const qint64 offset, const qint64 length);
     Q_SCRIPTABLE bool WriteData(const QByteArray& buffer, const QString& targetDevice, const qint64 targetOffset);
     Q_SCRIPTABLE bool WriteFstab(const QByteArray& fstabContents);
 
 private:
     bool isCallerAuthorized();
+    bool isCommandAllowed(const QString& command) const;
+    QVariantMap runCommand(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode) const;
 
-    void onReadOutput();
     QDBusServiceWatcher *m_serviceWatcher = nullptr;
 };
 
@@ -9,8 +9,8 @@
 */
 
 #include "util/helpers.h"
-#include "util/externalcommand.h"
 #include "util/globallog.h"
+#include "util/mounttable.h"
 
 #include "ops/operation.h"
 
@@ -30,17 +30,7 @@ bool caseInsensitiveLessThan(const QString& s1, const QString& s2)
 
 bool isMounted(const QString& deviceNode)
 {
-    ExternalCommand cmd(QStringLiteral("lsblk"),
-                        { QStringLiteral("--noheadings"),
-                          QStringLiteral("--nodeps"),
-                          QStringLiteral("--output"),
-                          QStringLiteral("mountpoint"),
-                          deviceNode });
-
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        return !cmd.output().trimmed().isEmpty();
-    }
-    return false;
+    return MountTable::self().isMounted(deviceNode);
 }
 
 KAboutData aboutKPMcore()
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/helpersession.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+#include <QThread>
+
+#include <atomic>
+
+HelperSession::HelperSession()
+{
+    if (!QDBusConnection::systemBus().isConnected()) {
+        qWarning() << QDBusConnection::systemBus().lastError().message();
+        return;
+    }
+
+    m_Interface = new OrgKdeKpmcoreExternalcommandInterface(QStringLiteral("org.kde.kpmcore.helperinterface"),
+                QStringLiteral("/Helper"), QDBusConnection::systemBus(), this);
+    m_Interface->setTimeout(10 * 24 * 3600 * 1000); // 10 days
+
+    connect(m_Interface, &OrgKdeKpmcoreExternalcommandInterface::progress, this, &HelperSession::progress, Qt::DirectConnection);
+    connect(m_Interface, &OrgKdeKpmcoreExternalcommandInterface::report, this, &HelperSession::report, Qt::DirectConnection);
+
+    // The helper sends command output only to the caller, so it is not part of the generated interface
+    QDBusConnection::systemBus().connect(QStringLiteral("org.kde.kpmcore.helperinterface"), QStringLiteral("/Helper"),
+            QStringLiteral("org.kde.kpmcore.externalcommand"), QStringLiteral("commandOutput"),
+            this, SLOT(onCommandOutput(QString, QByteArray)));
+
+    // The first command may come from a worker thread that finishes before the helper does.
+    if (QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+}
+
+/** @return the helper session of this process, it is created on first use */
+HelperSession* HelperSession::self()
+{
+    static HelperSession* instance = new HelperSession;
+    return instance;
+}
+
+QDBusPendingCall HelperSession::disconnectedCall()
+{
+    return QDBusPendingCall::fromError(QDBusError(QDBusError::Disconnected, QStringLiteral("The system bus is not available.")));
+}
+
+/** @return the reply of a finished call to the helper, an empty map on errors */
+QVariantMap HelperSession::replyMap(const QDBusPendingCall& call)
+{
+    if (call.isError()) {
+        qWarning() << call.error();
+        return {};
+    }
+
+    QDBusPendingReply<QVariantMap> reply = call;
+    return reply.value();
+}
+
+/** Runs a command through the helper.
+    @param command full path of the command
+    @param args the arguments
+    @param input data written to the standard input of the command
+    @param processChannelMode a QProcess::ProcessChannelMode
+    @return the future reply with success, exitCode and output
+*/
+std::future<QVariantMap> HelperSession::runCommand(const QString& command, const QStringList& args, const QByteArray& input, int processChannelMode)
+{
+    return toFuture(call(&OrgKdeKpmcoreExternalcommandInterface::RunCommand, command, args, input, processChannelMode));
+}
+
+/** @overload
+    @param context the callback is invoked in the thread of this object, not at all if it is destroyed first
+    @param callback receives the reply with success, exitCode and output
+*/
+void HelperSession::runCommand(const QString& command, const QStringList& args, const QByteArray& input, int processChannelMode,
+                               QObject* context, const std::function<void(const QVariantMap&)>& callback)
+{
+    onFinished(call(&OrgKdeKpmcoreExternalcommandInterface::RunCommand, command, args, input, processChannelMode), context, callback);
+}
+
+/** Runs several commands through the helper with a single call.
+    @param commands maps with the command, arguments, input and processChannelMode of each command
+    @return the future replies with success, exitCode and output, in the order of the commands,
+            an empty list on errors
+*/
+std::future<QList<QVariantMap>> HelperSession::runCommands(const QVariantList& commands)
+{
+    QDBusPendingCall pending = call(&OrgKdeKpmcoreExternalcommandInterface::RunCommands, commands);
+    return std::async(std::launch::deferred, [pending] () mutable {
+        pending.waitForFinished();
+
+        QList<QVariantMap> replies;
+        if (pending.isError()) {
+            qWarning() << pending.error();
+            return replies;
+        }
+
+        QDBusPendingReply<QVariantList> reply = pending;
+        for (const auto& r : reply.value())
+            replies.append(qdbus_cast<QVariantMap>(r));
+
+        return replies;
+    });
+}
+
+/** The helper sends the output of StreamCommand to the calling process, tagged with the stream id.
+    @return a stream id that no other command of this process uses
+*/
+QString HelperSession::newStreamId()
+{
+    static std::atomic<quint64> counter{0};
+    return QDBusConnection::systemBus().baseService() + QLatin1Char('/') + QString::number(++counter);
+}
+
+void HelperSession::onCommandOutput(const QString& streamId, const QByteArray& output)
+{
+    Q_EMIT commandOutput(streamId, output);
+}
+
+/** @param call a pending call that replies with a QVariantMap
+    @return a future for the reply, waiting for it does not need an event loop
+*/
+std::future<QVariantMap> HelperSession::toFuture(const QDBusPendingCall& call)
+{
+    return std::async(std::launch::deferred, [call] () mutable {
+        call.waitForFinished();
+        return replyMap(call);
+    });
+}
+
+/** @param call a pending call that replies with a QVariantMap
+    @param context the callback is invoked in the thread of this object, not at all if it is destroyed first
+    @param callback receives the reply, an empty map on errors
+*/
+void HelperSession::onFinished(const QDBusPendingCall& call, QObject* context, const std::function<void(const QVariantMap&)>& callback)
+{
+    auto watcher = new QDBusPendingCallWatcher(call);
+    watcher->moveToThread(context->thread());
+    connect(context, &QObject::destroyed, watcher, &QObject::deleteLater);
+    connect(watcher, &QDBusPendingCallWatcher::finished, context, [callback] (QDBusPendingCallWatcher* watcher) {
+        callback(replyMap(*watcher));
+        watcher->deleteLater();
+    });
+}
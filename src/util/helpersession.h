@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_HELPERSESSION_H
+#define KPMCORE_HELPERSESSION_H
+
+#include "externalcommandhelper_interface.h"
+
+#include <functional>
+#include <future>
+#include <utility>
+
+#include <QDBusPendingCall>
+#include <QMutex>
+#include <QObject>
+#include <QVariantMap>
+
+/** Connection of this process to the privileged helper.
+
+    All commands share one D-Bus proxy, which lives in the main thread so that the progress
+    and report signals of the helper keep arriving no matter which thread started a command.
+    Calls may be made from any thread and cost one D-Bus message each. Replies can be
+    awaited through a std::future, which blocks without running an event loop, or handed
+    to a callback in the thread of a context object.
+*/
+class HelperSession : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(HelperSession)
+
+public:
+    static HelperSession* self();
+
+    bool isConnected() const {
+        return m_Interface != nullptr; /**< @return true if the system bus is available */
+    }
+
+    /** Calls a method of the helper.
+        @param method the method of the generated proxy, e.g. &OrgKdeKpmcoreExternalcommandInterface::RunCommand
+        @param args the arguments of the method
+        @return the pending reply, an error if the system bus is not available
+    */
+    template <typename Method, typename... Args>
+    QDBusPendingCall call(Method method, Args&&... args)
+    {
+        if (!m_Interface)
+            return disconnectedCall();
+
+        QMutexLocker locker(&m_Mutex);
+        return (m_Interface->*method)(std::forward<Args>(args)...);
+    }
+
+    std::future<QVariantMap> runCommand(const QString& command, const QStringList& args, const QByteArray& input, int processChannelMode);
+    void runCommand(const QString& command, const QStringList& args, const QByteArray& input, int processChannelMode,
+                    QObject* context, const std::function<void(const QVariantMap&)>& callback);
+    std::future<QList<QVariantMap>> runCommands(const QVariantList& commands);
+
+    static QString newStreamId();
+
+    static std::future<QVariantMap> toFuture(const QDBusPendingCall& call);
+    static void onFinished(const QDBusPendingCall& call, QObject* context, const std::function<void(const QVariantMap&)>& callback);
+
+Q_SIGNALS:
+    void progress(int);
+    void report(const QString&);
+    void commandOutput(const QString& streamId, const QByteArray& output);
+
+private Q_SLOTS:
+    void onCommandOutput(const QString& streamId, const QByteArray& output);
+
+private:
+    HelperSession();
+
+    static QDBusPendingCall disconnectedCall();
+    static QVariantMap replyMap(const QDBusPendingCall& call);
+
+    QMutex m_Mutex;
+    OrgKdeKpmcoreExternalcommandInterface* m_Interface = nullptr;
+};
+
+#endif
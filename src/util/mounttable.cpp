@@ -0,0 +1,179 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/mounttable.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+
+/** Reads everything from fd, starting at the beginning. For the files in /proc that also
+    clears a pending poll() event. */
+static QByteArray readAll(int fd)
+{
+    QByteArray data;
+    if (fd < 0 || lseek(fd, 0, SEEK_SET) != 0)
+        return data;
+
+    char buffer[16384];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        data.append(buffer, n);
+
+    return data;
+}
+
+/** The kernel writes spaces, tabs, newlines and backslashes in paths as octal escapes, e.g. \040. */
+static QString unescape(const QByteArray& field)
+{
+    QByteArray decoded;
+    decoded.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            bool ok;
+            const int c = field.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                decoded += static_cast<char>(c);
+                i += 3;
+                continue;
+            }
+        }
+        decoded += field[i];
+    }
+
+    return QFile::decodeName(decoded);
+}
+
+/** @return true if the file behind fd changed since it was last read completely */
+static bool changed(int fd)
+{
+    pollfd p = { fd, POLLPRI, 0 };
+    return fd >= 0 && poll(&p, 1, 0) > 0 && (p.revents & (POLLERR | POLLPRI));
+}
+
+MountTable::MountTable() :
+    m_MountInfoFd(open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC)),
+    m_SwapsFd(open("/proc/swaps", O_RDONLY | O_CLOEXEC))
+{
+}
+
+MountTable::~MountTable()
+{
+    if (m_MountInfoFd >= 0)
+        close(m_MountInfoFd);
+    if (m_SwapsFd >= 0)
+        close(m_SwapsFd);
+}
+
+/** @return the mount table of this process */
+MountTable& MountTable::self()
+{
+    static MountTable instance;
+    return instance;
+}
+
+/** Re-reads the mount table if it was never read or the kernel reported a change. */
+void MountTable::refresh()
+{
+    const bool mountsChanged = changed(m_MountInfoFd);
+    const bool swapsChanged = changed(m_SwapsFd);
+
+    if (!m_Loaded || mountsChanged)
+        readMountInfo();
+    if (!m_Loaded || swapsChanged)
+        readSwaps();
+
+    m_Loaded = true;
+}
+
+void MountTable::readMountInfo()
+{
+    m_MountPointsByDevice.clear();
+    m_MountPointsBySource.clear();
+
+    // 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+    const QList<QByteArray> lines = readAll(m_MountInfoFd).split('\n');
+    for (const QByteArray& line : lines) {
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf("-");
+        if (separator < 6 || separator + 2 >= fields.size())
+            continue;
+
+        const QList<QByteArray> majorMinor = fields[2].split(':');
+        if (majorMinor.size() != 2)
+            continue;
+
+        const QString mountPoint = unescape(fields[4]);
+        const dev_t device = makedev(majorMinor[0].toUInt(), majorMinor[1].toUInt());
+        m_MountPointsByDevice[device].append(mountPoint);
+
+        // Some file systems, e.g. btrfs, report an anonymous device number. For those the
+        // mount source is the only link to the block device.
+        const QString source = unescape(fields[separator + 2]);
+        if (source.startsWith(QStringLiteral("/dev/"))) {
+            const QString canonicalSource = QFileInfo(source).canonicalFilePath();
+            m_MountPointsBySource[canonicalSource.isEmpty() ? source : canonicalSource].append(mountPoint);
+        }
+    }
+}
+
+void MountTable::readSwaps()
+{
+    m_SwapDevices.clear();
+
+    // Filename  Type  Size  Used  Priority
+    const QList<QByteArray> lines = readAll(m_SwapsFd).split('\n');
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray path = lines[i].left(lines[i].indexOf(' '));
+        struct stat st;
+        if (!path.isEmpty() && stat(QFile::encodeName(unescape(path)).constData(), &st) == 0 && S_ISBLK(st.st_mode))
+            m_SwapDevices.insert(st.st_rdev);
+    }
+}
+
+QStringList MountTable::lookup(const QString& deviceNode) const
+{
+    struct stat st;
+    if (stat(QFile::encodeName(deviceNode).constData(), &st) == 0 && S_ISBLK(st.st_mode)) {
+        const auto it = m_MountPointsByDevice.constFind(st.st_rdev);
+        if (it != m_MountPointsByDevice.cend())
+            return it.value();
+    }
+
+    return m_MountPointsBySource.value(QFileInfo(deviceNode).canonicalFilePath());
+}
+
+/** @param deviceNode a block device node, symlinks are resolved
+    @return the mount points of the device, in the order they were mounted
+*/
+QStringList MountTable::mountPoints(const QString& deviceNode)
+{
+    QMutexLocker locker(&m_Mutex);
+    refresh();
+    return lookup(deviceNode);
+}
+
+/** @param deviceNode a block device node, symlinks are resolved
+    @return true if the device is mounted somewhere or used as swap
+*/
+bool MountTable::isMounted(const QString& deviceNode)
+{
+    QMutexLocker locker(&m_Mutex);
+    refresh();
+
+    struct stat st;
+    if (stat(QFile::encodeName(deviceNode).constData(), &st) == 0 && S_ISBLK(st.st_mode) && m_SwapDevices.contains(st.st_rdev))
+        return true;
+
+    return !lookup(deviceNode).isEmpty();
+}
@@ -0,0 +1,57 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_MOUNTTABLE_H
+#define KPMCORE_MOUNTTABLE_H
+
+#include <sys/types.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/** Snapshot of the mounted file systems and active swap devices.
+
+    The snapshot is read from /proc/self/mountinfo and /proc/swaps and indexed by the
+    major:minor number of the mounted device, so that looking up a device node costs a
+    stat() instead of a pass over all mounts. The kernel signals changes to both files
+    through poll(), every lookup checks for that without blocking and only re-reads
+    the files when something was mounted or unmounted in the meantime.
+
+    The snapshot is shared by the whole process and safe to use from several threads.
+*/
+class MountTable
+{
+    Q_DISABLE_COPY(MountTable)
+
+public:
+    static MountTable& self();
+
+    QStringList mountPoints(const QString& deviceNode);
+    bool isMounted(const QString& deviceNode);
+
+private:
+    MountTable();
+    ~MountTable();
+
+    void refresh();
+    void readMountInfo();
+    void readSwaps();
+    QStringList lookup(const QString& deviceNode) const;
+
+    QMutex m_Mutex;
+    int m_MountInfoFd = -1;
+    int m_SwapsFd = -1;
+    bool m_Loaded = false;
+
+    QHash<dev_t, QStringList> m_MountPointsByDevice;
+    QHash<QString, QStringList> m_MountPointsBySource;
+    QSet<dev_t> m_SwapDevices;
+};
+
+#endif
@@ -117,6 +117,18 @@ void Report::addOutput(const QString& s)
     root()->emitOutputChanged();
 }
 
+/** Tells this Report and all its parents how far the running command has got.
+
+    A Job follows the progress of the commands it runs through its own Report.
+
+    @param percent the progress in percent
+*/
+void Report::setProgress(int percent)
+{
+    for (Report* r = this; r != nullptr; r = r->parent())
+        Q_EMIT r->progressChanged(percent);
+}
+
 void Report::emitOutputChanged()
 {
     Q_EMIT outputChanged();
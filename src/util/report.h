@@ -40,6 +40,7 @@ public:
 
 Q_SIGNALS:
     void outputChanged();
+    void progressChanged(int percent);
 
 public:
     Report* newChild(const QString& cmd = QString());
@@ -75,6 +76,7 @@ public:
         m_Status = s;    /**< @param s the new status */
     }
     void addOutput(const QString& s);
+    void setProgress(int percent);
 
     QString toHtml() const;
     QString toText() const;
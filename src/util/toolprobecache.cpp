@@ -0,0 +1,146 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/toolprobecache.h"
+#include "util/externalcommand.h"
+
+#include <sys/stat.h>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// Written at the start of the cache file, bump the version when the format changes
+constexpr quint32 cacheMagic = 0x4b504d54; // "KPMT"
+constexpr quint32 cacheVersion = 1;
+
+/** Loads the results of earlier runs. */
+ToolProbeCache::ToolProbeCache()
+{
+    QFile file(cacheFile());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion)
+        return;
+
+    quint32 count;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Entry entry;
+        in >> key >> entry.modified >> entry.size >> entry.exitCode >> entry.hasOutput >> entry.output;
+        if (in.status() == QDataStream::Ok)
+            m_Entries.insert(key, entry);
+    }
+}
+
+/** @return the probe cache of this process */
+ToolProbeCache& ToolProbeCache::self()
+{
+    static ToolProbeCache instance;
+    return instance;
+}
+
+/** @return path of the file the results are kept in */
+QString ToolProbeCache::cacheFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/toolprobes");
+}
+
+/** Runs a support tool, unless the result of an earlier run of the same tool is known.
+    @param command name of the tool, it is looked up in PATH and the sbin directories
+    @param args arguments to run it with
+    @param exitCode receives the exit code of the tool
+    @param output if not nullptr, receives the output of the tool
+    @return true if the tool exists and could be run
+*/
+bool ToolProbeCache::probe(const QString& command, const QStringList& args, int& exitCode, QByteArray* output)
+{
+    QString path = QStandardPaths::findExecutable(command);
+    if (path.isEmpty())
+        path = QStandardPaths::findExecutable(command, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
+    if (path.isEmpty())
+        return false;
+
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0)
+        return false;
+
+    const qint64 modified = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    const QString key = (QStringList(path) + args).join(QLatin1Char('\0'));
+
+    QMutexLocker locker(&m_Mutex);
+
+    // Another thread may be running the same tool right now, use its result
+    while (m_Running.contains(key))
+        m_Finished.wait(&m_Mutex);
+
+    const auto it = m_Entries.constFind(key);
+    if (it != m_Entries.cend() && it->modified == modified && it->size == st.st_size && (it->hasOutput || !output)) {
+        exitCode = it->exitCode;
+        if (output)
+            *output = it->output;
+        return true;
+    }
+
+    m_Running.insert(key);
+    locker.unlock();
+
+    ExternalCommand cmd(path, args);
+    const bool started = cmd.run();
+
+    locker.relock();
+    m_Running.remove(key);
+    m_Finished.wakeAll();
+
+    // Failures to run are not cached, they usually mean that the helper was not available.
+    if (!started)
+        return false;
+
+    Entry entry;
+    entry.modified = modified;
+    entry.size = st.st_size;
+    entry.exitCode = cmd.exitCode();
+    entry.hasOutput = output != nullptr;
+    if (output)
+        entry.output = *output = cmd.rawOutput();
+
+    exitCode = entry.exitCode;
+
+    m_Entries.insert(key, entry);
+    m_Changed = true;
+    return true;
+}
+
+/** Writes the results to the cache directory if any tool was run since the last time. */
+void ToolProbeCache::save()
+{
+    QMutexLocker locker(&m_Mutex);
+    if (!m_Changed)
+        return;
+
+    const QString fileName = cacheFile();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out << cacheMagic << cacheVersion << static_cast<quint32>(m_Entries.size());
+    for (auto it = m_Entries.cbegin(); it != m_Entries.cend(); ++it)
+        out << it.key() << it->modified << it->size << it->exitCode << it->hasOutput << it->output;
+
+    if (file.commit())
+        m_Changed = false;
+}
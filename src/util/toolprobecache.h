@@ -0,0 +1,59 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_TOOLPROBECACHE_H
+#define KPMCORE_TOOLPROBECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+
+/** Results of running file system support tools to find out whether they are usable.
+
+    Every probe costs a process started by the helper. The results are kept in the user's
+    cache directory together with the modification time and size of the tool, so they stay
+    valid until the tool is updated, removed or replaced. With a warm cache detecting the
+    available tools does not start any process.
+
+    The cache is shared by the whole process and safe to use from several threads. A tool
+    that is probed by several threads at once is only run once.
+*/
+class ToolProbeCache
+{
+    Q_DISABLE_COPY(ToolProbeCache)
+
+public:
+    static ToolProbeCache& self();
+
+    bool probe(const QString& command, const QStringList& args, int& exitCode, QByteArray* output = nullptr);
+    void save();
+
+private:
+    struct Entry
+    {
+        qint64 modified = -1;
+        qint64 size = -1;
+        int exitCode = -1;
+        bool hasOutput = false;
+        QByteArray output;
+    };
+
+    ToolProbeCache();
+
+    static QString cacheFile();
+
+    QMutex m_Mutex;
+    QHash<QString, Entry> m_Entries;
+    QSet<QString> m_Running;      // keys of the tools being run
+    QWaitCondition m_Finished;
+    bool m_Changed = false;
+};
+
+#endif
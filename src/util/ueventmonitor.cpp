@@ -0,0 +1,178 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/ueventmonitor.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSocketNotifier>
+
+// Multicast group udev sends its events to, the kernel uses group 1
+constexpr unsigned int udevGroup = 2;
+
+// Messages from udev start with this prefix and a header in front of the properties
+constexpr char udevPrefix[] = "libudev";
+constexpr quint32 udevMagic = 0xfeedcafe;
+
+/** Starts listening.
+    @param socketPath path of a local datagram socket to listen on instead of netlink, for tests
+    @param parent the parent object
+*/
+UeventMonitor::UeventMonitor(const QString& socketPath, QObject* parent) :
+    QObject(parent),
+    m_SocketPath(socketPath)
+{
+    if (socketPath.isEmpty()) {
+        m_Socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+
+        sockaddr_nl address = {};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = udevGroup;
+        if (m_Socket >= 0 && bind(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(m_Socket);
+            m_Socket = -1;
+        }
+    } else {
+        const QByteArray path = QFile::encodeName(socketPath);
+        m_Socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= static_cast<int>(sizeof(address.sun_path))) {
+            close(m_Socket);
+            m_Socket = -1;
+        } else if (m_Socket >= 0) {
+            memcpy(address.sun_path, path.constData(), path.size());
+            unlink(path.constData());
+            if (bind(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                close(m_Socket);
+                m_Socket = -1;
+            }
+        }
+    }
+
+    if (m_Socket < 0) {
+        qWarning() << "Could not listen for device events:" << strerror(errno);
+        return;
+    }
+
+    // The credentials of the sender come with every message
+    const int on = 1;
+    setsockopt(m_Socket, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+
+    m_Notifier = new QSocketNotifier(m_Socket, QSocketNotifier::Read, this);
+    connect(m_Notifier, &QSocketNotifier::activated, this, &UeventMonitor::readEvents);
+}
+
+UeventMonitor::~UeventMonitor()
+{
+    if (m_Socket < 0)
+        return;
+
+    delete m_Notifier;
+    close(m_Socket);
+
+    if (!m_SocketPath.isEmpty())
+        unlink(QFile::encodeName(m_SocketPath).constData());
+}
+
+/** Reads all pending messages. */
+void UeventMonitor::readEvents()
+{
+    char buffer[8192];
+    char control[CMSG_SPACE(sizeof(ucred))];
+
+    while (true) {
+        iovec iov = { buffer, sizeof(buffer) };
+        msghdr message = {};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        const ssize_t size = recvmsg(m_Socket, &message, MSG_DONTWAIT);
+        if (size <= 0)
+            return;
+
+        // Anybody may send to the udev group, only trust udev itself. The test socket
+        // accepts messages from the user running the monitor, too.
+        const cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (!header || header->cmsg_type != SCM_CREDENTIALS)
+            continue;
+
+        ucred credentials;
+        memcpy(&credentials, CMSG_DATA(header), sizeof(credentials));
+        if (credentials.uid != 0 && (m_SocketPath.isEmpty() || credentials.uid != getuid()))
+            continue;
+
+        parse(QByteArray(buffer, static_cast<int>(size)));
+    }
+}
+
+/** Parses one message and reports it if it is about a block device.
+
+    Kernel messages are "action@devpath" followed by KEY=value properties, udev messages a
+    header followed by the properties. All strings are 0 terminated.
+*/
+void UeventMonitor::parse(const QByteArray& message)
+{
+    QByteArray properties = message;
+
+    if (message.startsWith(QByteArray(udevPrefix, sizeof(udevPrefix)))) {
+        // prefix, magic, header size, properties offset, properties length. Only the magic
+        // is in network byte order, udev writes the other fields in host byte order.
+        if (message.size() < static_cast<int>(sizeof(udevPrefix) + 4 * sizeof(quint32)))
+            return;
+
+        quint32 fields[4];
+        memcpy(fields, message.constData() + sizeof(udevPrefix), sizeof(fields));
+        const quint32 offset = fields[2];
+        const quint32 length = fields[3];
+        if (ntohl(fields[0]) != udevMagic || offset > static_cast<quint32>(message.size()) || length > message.size() - offset)
+            return;
+
+        properties = message.mid(offset, length);
+    }
+
+    QHash<QByteArray, QByteArray> values;
+    const QList<QByteArray> lines = properties.split('\0');
+    for (const QByteArray& line : lines) {
+        const int separator = line.indexOf('=');
+        if (separator > 0)
+            values.insert(line.left(separator), line.mid(separator + 1));
+    }
+
+    if (values.value("SUBSYSTEM") != "block")
+        return;
+
+    const QString action = QString::fromLatin1(values.value("ACTION"));
+    const QString devName = QFile::decodeName(values.value("DEVNAME"));
+    const QString devPath = QFile::decodeName(values.value("DEVPATH"));
+    if (action.isEmpty() || devName.isEmpty())
+        return;
+
+    // udev sends the full path, the kernel just the name
+    const QString deviceNode = devName.startsWith(QLatin1Char('/')) ? devName : QStringLiteral("/dev/") + devName;
+
+    // .../block/sda/sda1 for a partition on /dev/sda
+    const QString diskNode = values.value("DEVTYPE") == "partition"
+        ? QStringLiteral("/dev/") + devPath.section(QLatin1Char('/'), -2, -2)
+        : deviceNode;
+
+    Q_EMIT blockDeviceEvent(action, deviceNode, diskNode);
+}
+
+#include "moc_ueventmonitor.cpp"
@@ -0,0 +1,55 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_UEVENTMONITOR_H
+#define KPMCORE_UEVENTMONITOR_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+/** Reports block devices that were added, removed or changed.
+
+    Listens to the events udev sends over netlink once it is done with a device, so the
+    device node exists and udev's probes are finished when an event arrives. Only events
+    sent by root are accepted.
+
+    For tests, the monitor can listen on a local datagram socket instead, which takes
+    messages in the same format as the kernel or udev sends them.
+*/
+class UeventMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(UeventMonitor)
+
+public:
+    explicit UeventMonitor(const QString& socketPath = QString(), QObject* parent = nullptr);
+    ~UeventMonitor() override;
+
+    bool isValid() const {
+        return m_Socket >= 0; /**< @return true if the monitor is listening */
+    }
+
+Q_SIGNALS:
+    /** A block device was added, removed or changed.
+        @param action the uevent action, e.g. "add", "remove" or "change"
+        @param deviceNode the device node of the device, e.g. /dev/sda1
+        @param diskNode the device node of the disk the device is on, e.g. /dev/sda
+    */
+    void blockDeviceEvent(const QString& action, const QString& deviceNode, const QString& diskNode);
+
+private:
+    void readEvents();
+    void parse(const QByteArray& message);
+
+    int m_Socket = -1;
+    QString m_SocketPath;
+    QSocketNotifier* m_Notifier = nullptr;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/uringcopy.h"
+
+#include <cstring>
+
+#include <utility>
+
+#include <sys/uio.h>
+
+#include <QDebug>
+
+/** Sets up the ring and allocates its buffers.
+    @param queueDepth the number of chunks to keep in flight
+    @param bufferSize size of each buffer in bytes
+*/
+UringCopy::UringCopy(int queueDepth, qint64 bufferSize) :
+    m_Slots(qMax(queueDepth, 1))
+{
+    // Every slot has at most one request in flight.
+    int rc = io_uring_queue_init(static_cast<unsigned>(m_Slots.size()), &m_Ring, 0);
+    if (rc < 0) {
+        qWarning() << "io_uring is not available:" << strerror(-rc);
+        return;
+    }
+
+    std::vector<iovec> iovecs;
+    for (std::size_t i = 0; i < m_Slots.size(); ++i) {
+        AlignedBuffer buffer = allocateAlignedBuffer(bufferSize);
+        if (!buffer) {
+            io_uring_queue_exit(&m_Ring);
+            return;
+        }
+        m_Slots[i].data = buffer.get();
+        m_Slots[i].bufferIndex = static_cast<int>(i);
+        iovecs.push_back({buffer.get(), static_cast<size_t>(bufferSize)});
+        m_Buffers.push_back(std::move(buffer));
+    }
+
+    // Registration can fail if the buffers exceed RLIMIT_MEMLOCK, unregistered buffers still work.
+    m_FixedBuffers = io_uring_register_buffers(&m_Ring, iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+    m_Valid = true;
+}
+
+UringCopy::~UringCopy()
+{
+    if (m_Valid)
+        io_uring_queue_exit(&m_Ring);
+}
+
+/** Copies all chunks from sourceFd to targetFd.
+    @param sourceFd file descriptor to read from, must be seekable
+    @param targetFd file descriptor to write to
+    @param nextChunk produces the chunks to copy in order
+    @param finished called after each chunk was written, in chunk order
+    @return true if every chunk was read and written successfully
+*/
+bool UringCopy::run(int sourceFd, int targetFd, const CopyPipeline::NextChunkFunction& nextChunk, const CopyPipeline::FinishedFunction& finished)
+{
+    if (!isValid())
+        return false;
+
+    const qint64 slotCount = static_cast<qint64>(m_Slots.size());
+    qint64 nextRead = 0;
+    qint64 nextWrite = 0;
+    qint64 nextFinished = 0;
+    int inFlight = 0;
+    bool exhausted = false;
+
+    while (!exhausted || nextFinished < nextRead) {
+        // Hand finished chunks back in order, freeing their slots for new reads.
+        while (nextFinished < nextWrite && m_Slots[nextFinished % slotCount].state == SlotState::Written) {
+            Slot& slot = m_Slots[nextFinished % slotCount];
+            finished(slot.chunk);
+            slot.state = SlotState::Free;
+            ++nextFinished;
+        }
+
+        while (!exhausted && m_Slots[nextRead % slotCount].state == SlotState::Free) {
+            Slot& slot = m_Slots[nextRead % slotCount];
+            if (!nextChunk(slot.chunk)) {
+                exhausted = true;
+                break;
+            }
+            slot.done = 0;
+            slot.state = SlotState::Reading;
+            if (!submit(slot, sourceFd))
+                return drain(inFlight);
+            ++inFlight;
+            ++nextRead;
+        }
+
+        // Writes are submitted strictly in chunk order, so chunk n is only written after
+        // every chunk before it was read. This is what keeps moves within one device safe.
+        while (nextWrite < nextRead && m_Slots[nextWrite % slotCount].state == SlotState::Read) {
+            Slot& slot = m_Slots[nextWrite % slotCount];
+            slot.done = 0;
+            slot.state = SlotState::Writing;
+            if (!submit(slot, targetFd))
+                return drain(inFlight);
+            ++inFlight;
+            ++nextWrite;
+        }
+
+        if (exhausted && nextFinished == nextRead)
+            break;
+
+        io_uring_submit(&m_Ring);
+
+        io_uring_cqe *cqe = nullptr;
+        int rc = io_uring_wait_cqe(&m_Ring, &cqe);
+        if (rc < 0) {
+            qCritical() << "io_uring_wait_cqe failed:" << strerror(-rc);
+            return drain(inFlight);
+        }
+
+        Slot& slot = *static_cast<Slot*>(io_uring_cqe_get_data(cqe));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&m_Ring, cqe);
+        --inFlight;
+
+        const bool reading = slot.state == SlotState::Reading;
+        if (res <= 0) {
+            qCritical() << (reading ? "Could not read" : "Could not write") << "at offset"
+                        << (reading ? slot.chunk.readOffset : slot.chunk.writeOffset) + slot.done << (res < 0 ? strerror(-res) : "unexpected end of file");
+            return drain(inFlight);
+        }
+
+        slot.done += res;
+        if (slot.done < slot.chunk.size) {
+            // Short transfer, continue where it stopped.
+            if (!submit(slot, reading ? sourceFd : targetFd))
+                return drain(inFlight);
+            ++inFlight;
+            continue;
+        }
+
+        slot.state = reading ? SlotState::Read : SlotState::Written;
+    }
+
+    return true;
+}
+
+bool UringCopy::submit(Slot& slot, int fd)
+{
+    io_uring_sqe *sqe = io_uring_get_sqe(&m_Ring);
+    if (!sqe) {
+        io_uring_submit(&m_Ring);
+        sqe = io_uring_get_sqe(&m_Ring);
+    }
+    if (!sqe)
+        return false;
+
+    const bool reading = slot.state == SlotState::Reading;
+    char *data = slot.data + slot.done;
+    const unsigned length = static_cast<unsigned>(slot.chunk.size - slot.done);
+    const qint64 offset = (reading ? slot.chunk.readOffset : slot.chunk.writeOffset) + slot.done;
+
+    if (m_FixedBuffers && reading)
+        io_uring_prep_read_fixed(sqe, fd, data, length, offset, slot.bufferIndex);
+    else if (m_FixedBuffers)
+        io_uring_prep_write_fixed(sqe, fd, data, length, offset, slot.bufferIndex);
+    else if (reading)
+        io_uring_prep_read(sqe, fd, data, length, offset);
+    else
+        io_uring_prep_write(sqe, fd, data, length, offset);
+
+    io_uring_sqe_set_data(sqe, &slot);
+    return true;
+}
+
+/** Waits for outstanding requests so that no buffer is released while the kernel still uses it.
+    @return always false, drain is only used on the error path
+*/
+bool UringCopy::drain(int inFlight)
+{
+    io_uring_submit(&m_Ring);
+    while (inFlight > 0) {
+        io_uring_cqe *cqe = nullptr;
+        if (io_uring_wait_cqe(&m_Ring, &cqe) < 0)
+            break;
+        io_uring_cqe_seen(&m_Ring, cqe);
+        --inFlight;
+    }
+
+    return false;
+}
@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_URINGCOPY_H
+#define KPMCORE_URINGCOPY_H
+
+#include "util/copypipeline.h"
+
+#include <vector>
+
+#include <liburing.h>
+
+#include <QtGlobal>
+
+/** io_uring based copy engine used by the helper.
+
+    Keeps up to queueDepth chunks in flight at once. Buffers are allocated once and
+    registered with the kernel as fixed buffers when possible, otherwise plain
+    read/write requests are used on the same buffers.
+
+    Reads may complete in any order, but the write of chunk n is only submitted once
+    chunks 0..n have been read, and chunks are reported as finished in order. This keeps
+    the same overlap guarantees as CopyPipeline for moves within one device.
+*/
+class UringCopy
+{
+    Q_DISABLE_COPY(UringCopy)
+
+public:
+    UringCopy(int queueDepth, qint64 bufferSize);
+    ~UringCopy();
+
+    bool isValid() const {
+        return m_Valid; /**< @return true if the ring and its buffers could be set up */
+    }
+    bool fixedBuffers() const {
+        return m_FixedBuffers; /**< @return true if buffers are registered with the kernel */
+    }
+    int queueDepth() const {
+        return static_cast<int>(m_Slots.size()); /**< @return number of chunks kept in flight */
+    }
+
+    bool run(int sourceFd, int targetFd, const CopyPipeline::NextChunkFunction& nextChunk, const CopyPipeline::FinishedFunction& finished);
+
+private:
+    enum class SlotState {
+        Free,
+        Reading,
+        Read,
+        Writing,
+        Written
+    };
+
+    struct Slot
+    {
+        char* data = nullptr;
+        int bufferIndex = 0;
+        SlotState state = SlotState::Free;
+        CopyChunk chunk = {0, 0, 0};
+        qint64 done = 0;
+    };
+
+    bool submit(Slot& slot, int fd);
+    bool drain(int inFlight);
+
+    io_uring m_Ring;
+    bool m_Valid = false;
+    bool m_FixedBuffers = false;
+    std::vector<Slot> m_Slots;
+    std::vector<AlignedBuffer> m_Buffers;
+};
+
+#endif
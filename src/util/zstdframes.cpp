@@ -0,0 +1,96 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/zstdframes.h"
+
+#include <QDebug>
+
+// Smallest amount of input a zstd worker thread takes on, see ZSTD_c_jobSize
+constexpr int zstdJobSize = 1 << 20;
+
+/** Creates a compressor.
+    @param level zstd compression level
+    @param workers number of zstd worker threads, 0 compresses in the calling thread
+*/
+ZstdFrameCompressor::ZstdFrameCompressor(int level, int workers) :
+    m_Context(ZSTD_createCCtx())
+{
+    if (!m_Context)
+        return;
+
+    ZSTD_CCtx_setParameter(m_Context, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(m_Context, ZSTD_c_checksumFlag, 1);
+    ZSTD_CCtx_setParameter(m_Context, ZSTD_c_contentSizeFlag, 1);
+
+    // Older or single threaded builds of libzstd reject nbWorkers, the frames are the same either way.
+    if (workers > 0 && !ZSTD_isError(ZSTD_CCtx_setParameter(m_Context, ZSTD_c_nbWorkers, workers)))
+        ZSTD_CCtx_setParameter(m_Context, ZSTD_c_jobSize, zstdJobSize);
+}
+
+ZstdFrameCompressor::~ZstdFrameCompressor()
+{
+    ZSTD_freeCCtx(m_Context);
+}
+
+/** Compresses one chunk into a frame.
+    @param data the chunk
+    @param size size of the chunk in bytes
+    @param frame receives the compressed frame
+    @param entry receives the seek table entry of the frame
+    @return true on success
+*/
+bool ZstdFrameCompressor::compress(const char* data, qint64 size, QByteArray& frame, CompressedBackup::Frame& entry)
+{
+    frame.resize(static_cast<int>(ZSTD_compressBound(size)));
+
+    const size_t result = ZSTD_compress2(m_Context, frame.data(), frame.size(), data, size);
+    if (ZSTD_isError(result)) {
+        qCritical() << "zstd compression failed:" << ZSTD_getErrorName(result);
+        return false;
+    }
+
+    frame.resize(static_cast<int>(result));
+
+    // The frame ends with the lower 32 bits of its XXH64 checksum.
+    entry.compressedSize = static_cast<quint32>(result);
+    entry.decompressedSize = static_cast<quint32>(size);
+    entry.checksum = qFromLittleEndian<quint32>(frame.constData() + result - 4);
+    return true;
+}
+
+ZstdFrameDecompressor::ZstdFrameDecompressor() :
+    m_Context(ZSTD_createDCtx())
+{
+}
+
+ZstdFrameDecompressor::~ZstdFrameDecompressor()
+{
+    ZSTD_freeDCtx(m_Context);
+}
+
+/** Decompresses one frame.
+    @param frame the compressed frame as read from the backup
+    @param entry the seek table entry of the frame
+    @param buffer memory of at least entry.decompressedSize bytes
+    @return true if the frame matches its seek table entry and decompressed without errors
+*/
+bool ZstdFrameDecompressor::decompress(const QByteArray& frame, const CompressedBackup::Frame& entry, char* buffer)
+{
+    if (frame.size() != static_cast<int>(entry.compressedSize) || frame.size() < 4
+            || qFromLittleEndian<quint32>(frame.constData() + frame.size() - 4) != entry.checksum) {
+        qCritical() << "Compressed frame does not match the seek table.";
+        return false;
+    }
+
+    // zstd verifies the content checksum while decompressing.
+    const size_t result = ZSTD_decompressDCtx(m_Context, buffer, entry.decompressedSize, frame.constData(), frame.size());
+    if (ZSTD_isError(result) || result != entry.decompressedSize) {
+        qCritical() << "zstd decompression failed:" << (ZSTD_isError(result) ? ZSTD_getErrorName(result) : "size mismatch");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_ZSTDFRAMES_H
+#define KPMCORE_ZSTDFRAMES_H
+
+#include "util/compressedbackup.h"
+
+#include <zstd.h>
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/** Compresses chunks of a backup into independent zstd frames.
+
+    Every chunk becomes a frame of its own, so that frames can be decompressed in any
+    order. Large chunks are compressed by several zstd worker threads in parallel.
+*/
+class ZstdFrameCompressor
+{
+    Q_DISABLE_COPY(ZstdFrameCompressor)
+
+public:
+    ZstdFrameCompressor(int level, int workers);
+    ~ZstdFrameCompressor();
+
+    bool isValid() const {
+        return m_Context != nullptr; /**< @return true if the compression context could be set up */
+    }
+
+    bool compress(const char* data, qint64 size, QByteArray& frame, CompressedBackup::Frame& entry);
+
+private:
+    ZSTD_CCtx* m_Context;
+};
+
+/** Decompresses single frames written by ZstdFrameCompressor. */
+class ZstdFrameDecompressor
+{
+    Q_DISABLE_COPY(ZstdFrameDecompressor)
+
+public:
+    ZstdFrameDecompressor();
+    ~ZstdFrameDecompressor();
+
+    bool isValid() const {
+        return m_Context != nullptr; /**< @return true if the decompression context could be set up */
+    }
+
+    bool decompress(const QByteArray& frame, const CompressedBackup::Frame& entry, char* buffer);
+
+private:
+    ZSTD_DCtx* m_Context;
+};
+
+#endif
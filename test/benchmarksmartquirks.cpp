@@ -0,0 +1,172 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Measures how long parsing the SMART attributes of one disk takes, with the quirk lookup
+// that compiled the whole quirk database for every attribute and with the compiled one.
+
+#include "helpers.h"
+
+// The quirk database and its matcher are internal to the parser
+#include "core/smartattributeparseddata.cpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+
+struct Disk
+{
+    QString model;
+    QString firmware;
+};
+
+static const QVector<Disk> disks = {
+    { QStringLiteral("FUJITSU MHY2120BH"), QStringLiteral("0085000B") },
+    { QStringLiteral("SAMSUNG SP40A2H"), QStringLiteral("RR100-07") },
+    { QStringLiteral("SAMSUNG SP40A2H"), QStringLiteral("RR100-08") },
+    { QStringLiteral("Maxtor 6L250R0"), QStringLiteral("BAH41G10") },
+    { QStringLiteral("HTS541010G9SA00"), QStringLiteral("MBZOC60P") },
+    { QStringLiteral("INTEL SSDSA2CT040G3"), QStringLiteral("4PC10362") },
+    { QStringLiteral("WDC WD10EZEX-08WN4A0"), QStringLiteral("01.01A01") },
+    { QStringLiteral("Samsung SSD 860 EVO 500GB"), QStringLiteral("RVT04B6Q") },
+    { QStringLiteral("ST4000DM004-2CV104"), QStringLiteral("0001") },
+};
+
+/** The lookup before the database was compiled once: every entry's patterns compiled per call. */
+static SmartQuirk uncompiledQuirk(const QString& model, const QString& firmware)
+{
+    const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
+
+    QRegularExpression modelRegex;
+    QRegularExpression firmwareRegex;
+
+    for (const SmartAttributeParsedData::SmartQuirkDataBase &item : db) {
+        if (!item.model.isEmpty()) {
+            modelRegex.setPattern(item.model);
+            if (!modelRegex.match(model).hasMatch())
+                continue;
+        }
+        if (!item.firmware.isEmpty()) {
+            firmwareRegex.setPattern(item.firmware);
+            if (!firmwareRegex.match(firmware).hasMatch())
+                continue;
+        }
+        return item.quirk;
+    }
+
+    return SmartQuirk::None;
+}
+
+/** @return the attributes smartctl --json reports for a typical disk */
+static QVector<QJsonObject> attributes()
+{
+    static const int ids[] = { 1, 3, 4, 5, 7, 9, 10, 12, 183, 184, 187, 188, 189, 190, 191, 192, 193, 194, 195, 197, 198, 199, 240, 241, 242 };
+
+    QVector<QJsonObject> result;
+    for (const int id : ids) {
+        QJsonObject flags;
+        flags[QStringLiteral("prefailure")] = id < 10;
+        flags[QStringLiteral("updated_online")] = true;
+
+        QJsonObject raw;
+        raw[QStringLiteral("value")] = id * 1000;
+
+        QJsonObject attribute;
+        attribute[QStringLiteral("id")] = id;
+        attribute[QStringLiteral("value")] = 100;
+        attribute[QStringLiteral("worst")] = 95;
+        attribute[QStringLiteral("thresh")] = 6;
+        attribute[QStringLiteral("flags")] = flags;
+        attribute[QStringLiteral("raw")] = raw;
+        result.append(attribute);
+    }
+    return result;
+}
+
+static bool testMatches()
+{
+    const SmartQuirkMatcher matcher;
+    for (const auto& disk : disks) {
+        const SmartQuirk expected = uncompiledQuirk(disk.model, disk.firmware);
+        CHECK(matcher.match(disk.model, disk.firmware) == expected);
+        CHECK(getQuirk(disk.model, disk.firmware) == expected);
+    }
+
+    // Entries that need a firmware fall through to the next entry, or to none
+    CHECK(matcher.match(QStringLiteral("SAMSUNG SP40A2H"), QStringLiteral("RR100-07")) == SmartQuirk::SMART_QUIRK_9_POWERONHALFMINUTES);
+    CHECK(matcher.match(QStringLiteral("SAMSUNG SP40A2H"), QStringLiteral("RR100-08")) == SmartQuirk::None);
+
+    return true;
+}
+
+static void benchmark()
+{
+    const QVector<QJsonObject> json = attributes();
+    constexpr int rounds = 20;
+
+    // Before: every attribute looked up its quirk through the whole database
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& disk : disks) {
+            for (const auto& attribute : json) {
+                SmartAttributeParsedData parsed(nullptr, attribute);
+                Q_UNUSED(parsed)
+                uncompiledQuirk(disk.model, disk.firmware);
+            }
+        }
+    }
+    const qint64 before = timer.nsecsElapsed() / (rounds * disks.size());
+
+    // After, once per process
+    timer.restart();
+    const SmartQuirkMatcher matcher;
+    const qint64 compile = timer.nsecsElapsed();
+
+    // After, for the first disk of a model, whose quirk is not cached yet
+    timer.restart();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& disk : disks) {
+            for (const auto& attribute : json) {
+                SmartAttributeParsedData parsed(nullptr, attribute);
+                Q_UNUSED(parsed)
+            }
+            matcher.match(disk.model, disk.firmware);
+        }
+    }
+    const qint64 firstDisk = timer.nsecsElapsed() / (rounds * disks.size());
+
+    // After, with the quirk cached per model and firmware
+    timer.restart();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& disk : disks) {
+            SmartDiskInformation info;
+            info.setModel(disk.model);
+            info.setFirmware(disk.firmware);
+            for (const auto& attribute : json) {
+                SmartAttributeParsedData parsed(&info, attribute);
+                Q_UNUSED(parsed)
+            }
+        }
+    }
+    const qint64 after = timer.nsecsElapsed() / (rounds * disks.size());
+
+    qDebug() << "Parsing" << json.size() << "attributes per disk:";
+    qDebug() << "  database compiled per attribute:" << before / 1000 << "us";
+    qDebug() << "  compiling the database once:" << compile / 1000 << "us";
+    qDebug() << "  compiled database, first disk of a model:" << firstDisk / 1000 << "us";
+    qDebug() << "  compiled database, quirk cached:" << after / 1000 << "us";
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    if (!testMatches())
+        return EXIT_FAILURE;
+
+    benchmark();
+    return EXIT_SUCCESS;
+}
@@ -8,8 +8,21 @@
 #ifndef TEST_KPMHELPERS_H
 #define TEST_KPMHELPERS_H
 
+#include <QDebug>
+
 class QString;
 
+/**
+ * Fails the enclosing test function, which returns bool, if @p condition is false.
+ */
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            qWarning() << "Check failed:" << #condition; \
+            return false; \
+        } \
+    } while (0)
+
 /**
  * Use RAII to initialize the KPMcore library. Just instantiate one
  * object of this class to do "normal" initialization.
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Checks the random data generator of the helper against the test vectors of RFC 7539.
+
+#include "helpers.h"
+
+#include "util/chacha20.h"
+
+#include <cstring>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDebug>
+
+// 00:01:02:...:1f
+static const uint32_t key[8] = { 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c };
+
+// The RFC has a 32 bit counter and a 96 bit nonce, the first nonce word is the upper half of our counter
+static uint64_t counter(uint32_t blockCounter, uint32_t nonce0)
+{
+    return (static_cast<uint64_t>(nonce0) << 32) | blockCounter;
+}
+
+static uint64_t nonce(uint32_t nonce1, uint32_t nonce2)
+{
+    return (static_cast<uint64_t>(nonce2) << 32) | nonce1;
+}
+
+// RFC 7539 2.3.2, block function
+static bool testBlock()
+{
+    static const unsigned char expected[64] = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+    };
+
+    ChaCha20Stream stream(key, counter(1, 0x09000000), nonce(0x4a000000, 0));
+    char block[64];
+    stream.fill(block, sizeof(block));
+    CHECK(memcmp(block, expected, sizeof(expected)) == 0);
+
+    return true;
+}
+
+// RFC 7539 2.4.2, encryption of a message that spans two blocks
+static bool testEncryption()
+{
+    static const char plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+    static const unsigned char expected[114] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+        0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+        0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+        0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+        0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+        0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+        0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+        0x87, 0x4d,
+    };
+
+    ChaCha20Stream stream(key, counter(1, 0), nonce(0x4a000000, 0));
+    char keystream[sizeof(expected)];
+    stream.fill(keystream, sizeof(keystream));
+
+    for (size_t i = 0; i < sizeof(expected); ++i)
+        CHECK(static_cast<unsigned char>(plaintext[i] ^ keystream[i]) == expected[i]);
+
+    return true;
+}
+
+// Large buffers are split between threads, the result has to be one contiguous keystream
+static bool testThreads()
+{
+    const qint64 size = 64 << 20;
+    std::vector<char> buffer(size);
+    ChaCha20Stream(key, 0, 0).fill(buffer.data(), size);
+
+    for (const qint64 block : { qint64(0), qint64(12345), size / 64 / 2 + 3, size / 64 - 1 }) {
+        char expected[64];
+        ChaCha20Stream(key, block, 0).fill(expected, sizeof(expected));
+        CHECK(memcmp(buffer.data() + block * 64, expected, sizeof(expected)) == 0);
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // The keystream is serialized in host byte order, the test vectors are little endian
+    return EXIT_SUCCESS;
+#endif
+
+    return testBlock() && testEncryption() && testThreads() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Feeds the chunk size controller of the helper with chunks from a simulated device.
+
+#include "helpers.h"
+
+#include "util/chunksizecontroller.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThread>
+
+constexpr qint64 KiB = 1024;
+
+// Every chunk costs a fixed latency, so larger chunks give more throughput
+static void copyChunk(ChunkSizeController& controller, qint64 size)
+{
+    QThread::msleep(100);
+    controller.chunkFinished(size);
+}
+
+static bool testFixed()
+{
+    ChunkSizeController controller(256 * KiB, 4 * KiB, 1024 * KiB, false);
+    CHECK(controller.isSettled());
+    CHECK(controller.size() == 256 * KiB);
+    CHECK(!controller.chunkFinished(256 * KiB));
+    CHECK(controller.phases().isEmpty());
+
+    return true;
+}
+
+static bool testBounds()
+{
+    // Initial sizes are rounded down to the granularity and capped at the maximum
+    ChunkSizeController controller(10 * KiB, 4 * KiB, 64 * KiB, true);
+    CHECK(controller.size() == 8 * KiB);
+
+    ChunkSizeController large(1024 * KiB, 4 * KiB, 64 * KiB, true);
+    CHECK(large.size() == 64 * KiB);
+
+    ChunkSizeController tiny(1, 4 * KiB, 64 * KiB, true);
+    CHECK(tiny.size() == 4 * KiB);
+
+    return true;
+}
+
+static bool testGrowing()
+{
+    ChunkSizeController controller(64 * KiB, 4 * KiB, 256 * KiB, true);
+
+    // 64, 128 and 256 KiB are measured, 512 KiB exceeds the maximum
+    for (int i = 0; i < 100 && !controller.isSettled(); ++i) {
+        const qint64 size = controller.size();
+        CHECK(size % (4 * KiB) == 0 && size <= 256 * KiB);
+        copyChunk(controller, size);
+    }
+
+    CHECK(controller.isSettled());
+    CHECK(controller.size() == 256 * KiB);
+    CHECK(controller.phases().size() == 3);
+
+    // Chunks of other sizes, such as the short last chunk, are not measured
+    CHECK(!controller.chunkFinished(12 * KiB));
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    return testFixed() && testBounds() && testGrowing() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
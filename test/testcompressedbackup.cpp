@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Writes the header and seek table of a compressed backup and reads them back.
+
+#include "helpers.h"
+
+#include "util/compressedbackup.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QTemporaryFile>
+
+static bool testHeader()
+{
+    CompressedBackup::Header header;
+    header.sourceLength = 123456789012;
+    header.sectorSize = 4096;
+    header.fileSystemType = 7;
+
+    const QByteArray data = CompressedBackup::serializeHeader(header);
+    CHECK(data.size() == CompressedBackup::headerFrameSize);
+
+    CompressedBackup::Header parsed;
+    CHECK(CompressedBackup::parseHeader(data, parsed));
+    CHECK(parsed.sourceLength == header.sourceLength);
+    CHECK(parsed.sectorSize == header.sectorSize);
+    CHECK(parsed.fileSystemType == header.fileSystemType);
+
+    // Not a backup
+    QByteArray corrupt = data;
+    corrupt[10] = 'X';
+    CHECK(!CompressedBackup::parseHeader(corrupt, parsed));
+    CHECK(!CompressedBackup::parseHeader(data.left(CompressedBackup::headerFrameSize - 1), parsed));
+
+    return true;
+}
+
+static bool testSeekTable()
+{
+    const std::vector<CompressedBackup::Frame> frames = {
+        { 1000, 4096, 0x11111111 },
+        { 2000, 8192, 0x22222222 },
+        { 30, 4096, 0x33333333 },
+    };
+
+    QTemporaryFile file;
+    CHECK(file.open());
+
+    CompressedBackup::Header header;
+    header.sourceLength = 16384;
+    file.write(CompressedBackup::serializeHeader(header));
+    for (const auto& frame : frames)
+        file.write(QByteArray(frame.compressedSize, 'x'));
+    const QByteArray seekTable = CompressedBackup::serializeSeekTable(frames);
+    file.write(seekTable);
+    file.flush();
+
+    std::vector<CompressedBackup::Frame> read;
+    CHECK(CompressedBackup::readSeekTable(file, read));
+    CHECK(read.size() == frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        CHECK(read[i].compressedSize == frames[i].compressedSize);
+        CHECK(read[i].decompressedSize == frames[i].decompressedSize);
+        CHECK(read[i].checksum == frames[i].checksum);
+    }
+
+    // Readers of the seekable format sum up compressed sizes from the start of the file,
+    // the entries have to cover the header frame for that to end at the seek table.
+    const char* entries = seekTable.constData() + 8;
+    const quint32 count = qFromLittleEndian<quint32>(seekTable.constData() + seekTable.size() - CompressedBackup::seekTableFooterSize);
+    CHECK(count == frames.size() + 1);
+    qint64 offset = 0;
+    qint64 decompressed = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        offset += qFromLittleEndian<quint32>(entries + i * CompressedBackup::seekTableEntrySize);
+        decompressed += qFromLittleEndian<quint32>(entries + i * CompressedBackup::seekTableEntrySize + 4);
+    }
+    CHECK(offset == file.size() - seekTable.size());
+    CHECK(decompressed == header.sourceLength);
+
+    // A damaged footer is not mistaken for a seek table
+    file.seek(file.size() - 1);
+    file.write("X", 1);
+    file.flush();
+    CHECK(!CompressedBackup::readSeekTable(file, read));
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    return testHeader() && testSeekTable() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
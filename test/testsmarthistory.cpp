@@ -0,0 +1,132 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Records SMART values of a disk, reads them back and damages the history file.
+
+#include "helpers.h"
+
+#include "core/smarthistory.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QTemporaryDir>
+
+static const QString serial = QStringLiteral("WD-WCC4N1234567");
+
+static bool testRoundTrip()
+{
+    // Large values, values that go down, and series that are left out of a sample
+    CHECK(SmartHistory::append(serial, 1000, { { 5, 0 }, { 9, 123456789012 }, { SmartHistory::Temperature, 308150 } }));
+    CHECK(SmartHistory::append(serial, 1600, { { 5, 8 }, { 9, 123456789612 }, { SmartHistory::Temperature, 305150 } }));
+    CHECK(SmartHistory::append(serial, 2200, { { 9, 123456790212 } }));
+    CHECK(SmartHistory::append(serial, 87400, { { 5, 8 }, { 9, 123456875412 }, { SmartHistory::Temperature, -1 } }));
+
+    const SmartHistory history(serial);
+    CHECK(history.isValid());
+    CHECK(history.series() == QList<quint32>({ 5, 9, SmartHistory::Temperature }));
+
+    const QVector<SmartHistory::Sample> powerOn = history.samples(9);
+    CHECK(powerOn.size() == 4);
+    CHECK(powerOn[0].time == 1000 && powerOn[0].value == 123456789012);
+    CHECK(powerOn[2].time == 2200 && powerOn[2].value == 123456790212);
+    CHECK(powerOn[3].time == 87400 && powerOn[3].value == 123456875412);
+
+    // Every record has the last value of every series
+    const QVector<SmartHistory::Sample> temperature = history.samples(SmartHistory::Temperature);
+    CHECK(temperature.size() == 4);
+    CHECK(temperature[1].value == 305150 && temperature[2].value == 305150 && temperature[3].value == -1);
+
+    CHECK(history.samples(9, 1500, 2200).size() == 2);
+    CHECK(history.samples(197).isEmpty());
+
+    qint64 min, max;
+    CHECK(history.range(5, 0, 2200, min, max));
+    CHECK(min == 0 && max == 8);
+    CHECK(!history.range(5, 90000, 100000, min, max));
+
+    CHECK(qFuzzyCompare(history.rateOfChange(5, 1000, 87400), 8.0));
+    CHECK(history.rateOfChange(5, 1000, 1000) == 0);
+
+    return true;
+}
+
+static bool testTruncatedRecord()
+{
+    const QString path = SmartHistory::fileName(serial);
+    const qint64 size = QFile(path).size();
+
+    // A record that was cut short, e.g. by a crash while writing
+    QFile file(path);
+    CHECK(file.open(QIODevice::Append));
+    CHECK(file.write("\x20\x01\x02", 3) == 3);
+    file.close();
+
+    // Is ignored by readers
+    CHECK(SmartHistory(serial).samples(9).size() == 4);
+
+    // And overwritten by the next writer
+    CHECK(SmartHistory::append(serial, 90000, { { 9, 123456878012 } }));
+    CHECK(QFile(path).size() > size && QFile(path).size() < size + 10);
+
+    const QVector<SmartHistory::Sample> powerOn = SmartHistory(serial).samples(9);
+    CHECK(powerOn.size() == 5);
+    CHECK(powerOn.last().time == 90000 && powerOn.last().value == 123456878012);
+
+    return true;
+}
+
+static bool testDamagedHeader()
+{
+    const QString damaged = QStringLiteral("damaged");
+    CHECK(SmartHistory::append(damaged, 1000, { { 5, 0 } }));
+
+    QFile file(SmartHistory::fileName(damaged));
+    CHECK(file.open(QIODevice::ReadWrite));
+    CHECK(file.write("XXXX", 4) == 4);
+    file.close();
+
+    // Neither read nor appended to
+    CHECK(!SmartHistory(damaged).isValid());
+    CHECK(!SmartHistory::append(damaged, 2000, { { 5, 1 } }));
+    CHECK(!SmartHistory(QStringLiteral("unknown")).isValid());
+
+    return true;
+}
+
+static bool testFileNames()
+{
+    // Every serial has its own file, inside the history directory
+    const QStringList serials = { QStringLiteral("A/B"), QStringLiteral("A_B"), QStringLiteral("A%2FB"), QStringLiteral("."), QStringLiteral("..") };
+    QStringList names;
+    for (const QString& s : serials) {
+        const QString name = SmartHistory::fileName(s);
+        CHECK(!names.contains(name));
+        CHECK(name.startsWith(SmartHistory::directory() + QLatin1Char('/')));
+        CHECK(!name.mid(SmartHistory::directory().size() + 1).contains(QLatin1Char('/')));
+        CHECK(name != SmartHistory::directory() + QStringLiteral("/.") && name != SmartHistory::directory() + QStringLiteral("/.."));
+        names.append(name);
+    }
+
+    CHECK(SmartHistory::append(QStringLiteral("A/B"), 1000, { { 5, 1 } }));
+    CHECK(SmartHistory::append(QStringLiteral("A_B"), 1000, { { 5, 2 } }));
+    CHECK(SmartHistory(QStringLiteral("A/B")).samples(5).first().value == 1);
+    CHECK(SmartHistory(QStringLiteral("A_B")).samples(5).first().value == 2);
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir directory;
+    if (!directory.isValid())
+        return EXIT_FAILURE;
+    SmartHistory::setDirectory(directory.path());
+
+    return testRoundTrip() && testTruncatedRecord() && testDamagedHeader() && testFileNames() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
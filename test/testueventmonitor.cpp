@@ -0,0 +1,138 @@
+/*
+    SPDX-FileCopyrightText: 2026 KPMcore developers
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Sends device events the way udev and the kernel do to the test socket of the uevent monitor.
+
+#include "helpers.h"
+
+#include "util/ueventmonitor.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTimer>
+
+/** Properties as KEY=value strings, each 0 terminated */
+static QByteArray properties(const QList<QByteArray>& lines)
+{
+    QByteArray result;
+    for (const QByteArray& line : lines)
+        result += line + '\0';
+    return result;
+}
+
+/** A message as libudev sends it: header with the magic in network and everything else
+    in host byte order, followed by the properties. */
+static QByteArray udevMessage(const QByteArray& props, quint32 magic = 0xfeedcafe)
+{
+    struct {
+        char prefix[8];
+        quint32 magic;
+        quint32 headerSize;
+        quint32 propertiesOffset;
+        quint32 propertiesLength;
+        quint32 filterSubsystemHash;
+        quint32 filterDevtypeHash;
+        quint32 filterTagBloomHigh;
+        quint32 filterTagBloomLow;
+    } header = {};
+
+    memcpy(header.prefix, "libudev", 8);
+    header.magic = htonl(magic);
+    header.headerSize = sizeof(header);
+    header.propertiesOffset = sizeof(header);
+    header.propertiesLength = props.size();
+
+    return QByteArray(reinterpret_cast<const char*>(&header), sizeof(header)) + props;
+}
+
+/** A message as the kernel sends it: action@devpath followed by the properties. */
+static QByteArray kernelMessage(const QByteArray& action, const QByteArray& devPath, const QByteArray& props)
+{
+    return action + '@' + devPath + '\0' + props;
+}
+
+static bool send(const QString& path, const QByteArray& message)
+{
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    CHECK(fd >= 0);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    const QByteArray encoded = QFile::encodeName(path);
+    memcpy(address.sun_path, encoded.constData(), encoded.size());
+
+    const ssize_t sent = sendto(fd, message.constData(), message.size(), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    close(fd);
+    CHECK(sent == message.size());
+
+    return true;
+}
+
+static bool testEvents(const QString& path)
+{
+    UeventMonitor monitor(path);
+    CHECK(monitor.isValid());
+
+    QStringList events;
+    QEventLoop loop;
+    QObject::connect(&monitor, &UeventMonitor::blockDeviceEvent, [&] (const QString& action, const QString& deviceNode, const QString& diskNode) {
+        events.append(action + QLatin1Char(' ') + deviceNode + QLatin1Char(' ') + diskNode);
+        if (deviceNode == QStringLiteral("/dev/sdz"))
+            loop.quit();
+    });
+
+    const QByteArray sda1 = "/devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/block/sda/sda1";
+    const QByteArray sdb = "/devices/pci0000:00/0000:00:17.0/ata2/host1/target1:0:0/1:0:0:0/block/sdb";
+
+    // A partition from udev
+    CHECK(send(path, udevMessage(properties({ "ACTION=add", "DEVPATH=" + sda1, "SUBSYSTEM=block", "DEVNAME=/dev/sda1", "DEVTYPE=partition", "SEQNUM=1000" }))));
+
+    // A disk from the kernel
+    CHECK(send(path, kernelMessage("change", sdb, properties({ "ACTION=change", "DEVPATH=" + sdb, "SUBSYSTEM=block", "DEVNAME=sdb", "DEVTYPE=disk", "SEQNUM=1001" }))));
+
+    // Not a block device, not from udev, or damaged
+    CHECK(send(path, udevMessage(properties({ "ACTION=add", "DEVPATH=/devices/virtual/net/tap0", "SUBSYSTEM=net", "INTERFACE=tap0" }))));
+    CHECK(send(path, udevMessage(properties({ "ACTION=add", "DEVPATH=" + sda1, "SUBSYSTEM=block", "DEVNAME=/dev/sda1", "DEVTYPE=partition" }), 0xdeadbeef)));
+    QByteArray truncated = udevMessage(properties({ "ACTION=remove", "DEVPATH=" + sdb, "SUBSYSTEM=block", "DEVNAME=/dev/sdb", "DEVTYPE=disk" }));
+    truncated.chop(20);
+    CHECK(send(path, truncated));
+
+    // Marks the end
+    CHECK(send(path, udevMessage(properties({ "ACTION=remove", "DEVPATH=/devices/virtual/block/sdz", "SUBSYSTEM=block", "DEVNAME=/dev/sdz", "DEVTYPE=disk" }))));
+
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    CHECK(events == QStringList({
+        QStringLiteral("add /dev/sda1 /dev/sda"),
+        QStringLiteral("change /dev/sdb /dev/sdb"),
+        QStringLiteral("remove /dev/sdz /dev/sdz"),
+    }));
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir directory;
+    if (!directory.isValid())
+        return EXIT_FAILURE;
+
+    return testEvents(directory.filePath(QStringLiteral("uevent"))) ? EXIT_SUCCESS : EXIT_FAILURE;
+}